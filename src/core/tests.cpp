@@ -295,4 +295,1119 @@ TEST(constraint_solver, circle_single_restitution)
 	ASSERT_NEAR(b.m_linear_momentum.y, spd, 0.0001f);
 	ASSERT_NEAR(glm::length2(b.m_linear_momentum), spd*spd, 0.0001f);
 	ASSERT_NEAR(glm::length2(b.m_angular_momentum), 0.0f, 0.0001f);
-}
\ No newline at end of file
+}
+// Static geometry
+#include <physics/triangle_mesh.h>
+#include <physics/sat_triangle.h>
+physical_mesh make_unit_cube()
+{
+	physical_mesh mesh{};
+	mesh.m_vertices = {
+		glm::vec3{-0.5f,-0.5f,-0.5f}, glm::vec3{ 0.5f,-0.5f,-0.5f},
+		glm::vec3{ 0.5f, 0.5f,-0.5f}, glm::vec3{-0.5f, 0.5f,-0.5f},
+		glm::vec3{-0.5f,-0.5f, 0.5f}, glm::vec3{ 0.5f,-0.5f, 0.5f},
+		glm::vec3{ 0.5f, 0.5f, 0.5f}, glm::vec3{-0.5f, 0.5f, 0.5f}
+	};
+	mesh.add_face({ 0u,3u,2u,1u });
+	mesh.add_face({ 4u,5u,6u,7u });
+	mesh.add_face({ 0u,1u,5u,4u });
+	mesh.add_face({ 3u,7u,6u,2u });
+	mesh.add_face({ 0u,4u,7u,3u });
+	mesh.add_face({ 1u,2u,6u,5u });
+	mesh.create_twins();
+	return mesh;
+}
+triangle_mesh make_floor(int cells)
+{
+	triangle_mesh mesh{};
+	for (int z = 0; z <= cells; ++z)
+		for (int x = 0; x <= cells; ++x)
+			mesh.m_vertices.push_back({ (float)x, 0.0f, (float)z });
+	for (int z = 0; z < cells; ++z)
+		for (int x = 0; x < cells; ++x)
+		{
+			const uint a = z * (cells + 1) + x;
+			mesh.m_triangles.push_back({ a, a + cells + 1, a + cells + 2 });
+			mesh.m_triangles.push_back({ a, a + cells + 2, a + 1 });
+		}
+	mesh.build();
+	return mesh;
+}
+TEST(triangle_mesh, bvh_query)
+{
+	// Create floor
+	triangle_mesh mesh = make_floor(64);
+	// Query a box covering a single cell
+	std::vector<uint> tris;
+	mesh.query({ glm::vec3{10.1f,-1.0f,20.1f}, glm::vec3{10.9f,1.0f,20.9f} }, tris);
+	ASSERT_EQ(tris.size(), 2u);
+	// Query outside of the floor
+	tris.clear();
+	mesh.query({ glm::vec3{-5.0f,-1.0f,-5.0f}, glm::vec3{-1.0f,1.0f,-1.0f} }, tris);
+	ASSERT_TRUE(tris.empty());
+	// Ray cast from above
+	ray_info info = mesh.ray_cast({ glm::vec3{ 3.3f, 5.0f, 7.6f }, glm::vec3{ 0.0f,-1.0f,0.0f } });
+	ASSERT_TRUE(info.m_intersected);
+	ASSERT_NEAR(info.m_time, 5.0f, 0.0001f);
+	ASSERT_NEAR(info.m_normal.y, 1.0f, 0.0001f);
+}
+TEST(triangle_mesh, sat_triangle_resting_cube)
+{
+	// Create cube slightly sunk into a large triangle
+	physical_mesh cube = make_unit_cube();
+	const glm::mat4 AtoW = glm::translate(glm::mat4(1.0f), glm::vec3{ 0.0f, 0.45f, 0.0f });
+	const glm::mat4 BtoW{ 1.0f };
+	const glm::mat4 AtoB = glm::inverse(BtoW) * AtoW;
+	const glm::mat4 BtoA = glm::inverse(AtoB);
+	const glm::vec3 tri[3] = { {-10.0f, 0.0f,-10.0f}, {-10.0f, 0.0f, 30.0f}, { 30.0f, 0.0f,-10.0f} };
+	// Test collision
+	sat::result r = sat_triangle{ &cube, AtoW, AtoB, BtoA, tri }.test_collision();
+	ASSERT_TRUE(r.m_contact);
+	ASSERT_EQ(r.m_manifold.m_local_A.size(), 4u);
+	ASSERT_NEAR(r.m_manifold.m_normal.y, -1.0f, 0.0001f);
+	for (auto p : r.m_manifold.m_local_B)
+		ASSERT_NEAR(p.y, 0.0f, 0.0001f);
+	// Hulls behind the triangle are ignored
+	const glm::mat4 AtoW_below = glm::translate(glm::mat4(1.0f), glm::vec3{ 0.0f, -0.45f, 0.0f });
+	const glm::mat4 BtoA_below = glm::inverse(AtoW_below);
+	ASSERT_FALSE((sat_triangle{ &cube, AtoW_below, AtoW_below, BtoA_below, tri }.test_collision().m_contact));
+}
+#include <physics/heightfield.h>
+TEST(heightfield, query_and_ray_cast)
+{
+	// Create sloped terrain
+	heightfield field{};
+	std::vector<float> heights;
+	for (uint z = 0; z < 65u; ++z)
+		for (uint x = 0; x < 65u; ++x)
+			heights.push_back(0.1f * x);
+	field.set_heights(65u, 65u, 0.5f, heights);
+	// Quantized heights stay close to the source
+	ASSERT_NEAR(field.get_height(37u, 5u), 3.7f, 0.001f);
+	// Query a box covering a single cell
+	std::vector<uint> tris;
+	field.query({ glm::vec3{5.1f,-10.0f,5.1f}, glm::vec3{5.4f,10.0f,5.4f} }, tris);
+	ASSERT_EQ(tris.size(), 2u);
+	// Boxes above the terrain do not get any triangle
+	tris.clear();
+	field.query({ glm::vec3{5.1f,5.0f,5.1f}, glm::vec3{5.4f,6.0f,5.4f} }, tris);
+	ASSERT_TRUE(tris.empty());
+	// Ray cast from above
+	ray_info info = field.ray_cast({ glm::vec3{ 10.25f, 10.0f, 3.3f }, glm::vec3{ 0.0f,-1.0f,0.0f } });
+	ASSERT_TRUE(info.m_intersected);
+	ASSERT_NEAR(info.m_time, 10.0f - 2.05f, 0.001f);
+	// Grazing ray walking several cells
+	info = field.ray_cast({ glm::vec3{ 31.0f, 2.0f, 7.3f }, glm::normalize(glm::vec3{ -1.0f, 0.0f, 0.2f }) });
+	ASSERT_TRUE(info.m_intersected);
+	ASSERT_NEAR(ray({ glm::vec3{ 31.0f, 2.0f, 7.3f }, glm::normalize(glm::vec3{ -1.0f, 0.0f, 0.2f }) }).get_point(info.m_time).x, 10.0f, 0.001f);
+}
+TEST(constraint_solver, speculative_contact)
+{
+	// Create static body A
+	body a;
+	a.set_static(true);
+	// Create dynamic body B, separated from A and falling fast
+	const float gap = 0.1f;
+	body b;
+	b.set_restitution(0.0f);
+	b.set_mass(1.0f);
+	b.set_inertia(glm::mat3{ 1.0f / 6.0f });
+	b.set_position(glm::vec3{ 0, 0.5f + gap, 0 });
+	b.m_linear_momentum = { 0, -20.0f, 0 };
+	// Create pair
+	overlap_pair pair{ &a, &b, nullptr, nullptr };
+	pair.manifold.normal = { 0,1,0 };
+	pair.manifold.points.push_back(contact_point{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -0.5f, 0.0f) });
+	pair.update();
+	ASSERT_NEAR(pair.manifold.points[0].depth, -gap, 0.0001f);
+	//Fill overlap vector
+	std::vector<overlap_pair *> pairs{ &pair };
+	// Solve
+	constraint_contact_solver{ 8, 0.2f }.evaluate(pairs);
+	// Test solver: the body just closes the gap during this step
+	ASSERT_NEAR(b.get_linear_velocity().y, -gap / physics_dt, 0.001f);
+	// Slow bodies are not affected by speculative contacts
+	b.m_linear_momentum = { 0, -1.0f, 0 };
+	pair.manifold.points[0].lambda_Vel = 0.0f;
+	constraint_contact_solver{ 8, 0.2f }.evaluate(pairs);
+	ASSERT_NEAR(b.get_linear_velocity().y, -1.0f, 0.0001f);
+}
+
+#include <physics/ccd.h>
+TEST(ccd, conservative_advancement)
+{
+	physical_mesh cube = make_unit_cube();
+	// Create static wall A
+	body a;
+	a.set_static(true);
+	a.set_position(glm::vec3{ 10.0f, 0.0f, 0.0f });
+	// Create fast body B moving towards the wall
+	body b;
+	b.set_mass(1.0f);
+	b.set_inertia(glm::mat3{ 1.0f / 6.0f });
+	b.m_linear_momentum = { 100.0f, 0.0f, 0.0f };
+	// Faces meet after travelling 9 units
+	const float toi = conservative_advancement(b, cube, a, cube).time_of_impact(1.0f);
+	ASSERT_NEAR(toi, 0.09f, 0.001f);
+	// Moving away never hits
+	b.m_linear_momentum = { -100.0f, 0.0f, 0.0f };
+	ASSERT_EQ(conservative_advancement(b, cube, a, cube).time_of_impact(1.0f), 1.0f);
+	// Against a triangle laying under the body
+	a.set_position(glm::vec3{ 0.0f });
+	const glm::vec3 tri[3]{ {-5.0f, -10.0f, -5.0f}, {0.0f, -10.0f, 5.0f}, {5.0f, -10.0f, -5.0f} };
+	b.m_linear_momentum = { 0.0f, -95.0f, 0.0f };
+	ASSERT_NEAR(conservative_advancement(b, cube, a, tri).time_of_impact(1.0f), 0.1f, 0.001f);
+}
+
+TEST(overlap_pair, manifold_reuse)
+{
+	// Create resting pair
+	body a;
+	a.set_static(true);
+	body b;
+	b.set_position(glm::vec3{ 0.0f, 1.0f, 0.0f });
+	overlap_pair pair{ &a, &b, nullptr, nullptr };
+	sat::simple_manifold m;
+	m.m_normal = { 0.0f, 1.0f, 0.0f };
+	m.m_local_A = { glm::vec3{ 0.0f, 0.5f, 0.0f } };
+	m.m_local_B = { glm::vec3{ 0.0f, -0.5f, 0.0f } };
+	pair.add_manifold(m);
+	pair.m_state = overlap_pair::state::Collision;
+	// First call stores the transform of the full refresh
+	ASSERT_FALSE(pair.reuse_manifold(2));
+	// Unchanged pair reuses the manifold until forced to refresh
+	ASSERT_TRUE(pair.reuse_manifold(2));
+	ASSERT_TRUE(pair.reuse_manifold(2));
+	ASSERT_FALSE(pair.reuse_manifold(2));
+	// Moving above the tolerance forces a refresh
+	ASSERT_TRUE(pair.reuse_manifold(2));
+	b.set_position(glm::vec3{ 0.0f, 1.1f, 0.0f });
+	ASSERT_FALSE(pair.reuse_manifold(2));
+	// Rotating together keeps the normal in space of A
+	const glm::quat rot = glm::angleAxis(glm::half_pi<float>(), glm::vec3{ 0.0f, 0.0f, 1.0f });
+	a.set_rotation(rot);
+	b.set_rotation(rot);
+	b.set_position(rot * glm::vec3{ 0.0f, 1.1f, 0.0f });
+	ASSERT_TRUE(pair.reuse_manifold(2));
+	ASSERT_NEAR(pair.manifold.normal.x, -1.0f, 0.0001f);
+}
+
+TEST(overlap_pair, contact_skin)
+{
+	physical_mesh cube = make_unit_cube();
+	const float skin = 0.02f;
+	// Create resting pair
+	body a;
+	a.set_static(true);
+	body b;
+	b.set_position(glm::vec3{ 0.2f, 1.0f, 0.1f });
+	overlap_pair pair{ &a, &b, &cube, &cube };
+	pair.margin = skin;
+	sat::result r = sat{ &pair, skin }.test_collision();
+	ASSERT_TRUE(r.m_contact);
+	pair.add_manifold(r.m_manifold);
+	ASSERT_FALSE(pair.manifold.points.empty());
+	// Store warm start data
+	for (contact_point& p : pair.manifold.points)
+		p.lambda_Vel = 1.0f;
+	const std::vector<contact_point> resting = pair.manifold.points;
+	// Opening a gap within the skin keeps the points and their lambdas
+	b.set_position(glm::vec3{ 0.2f, 1.01f, 0.1f });
+	r = sat{ &pair, skin }.test_collision();
+	ASSERT_TRUE(r.m_contact);
+	pair.add_manifold(r.m_manifold);
+	ASSERT_EQ(pair.manifold.points.size(), resting.size());
+	for (uint i = 0; i < resting.size(); ++i)
+	{
+		ASSERT_EQ(pair.manifold.points[i].local_A, resting[i].local_A);
+		ASSERT_EQ(pair.manifold.points[i].lambda_Vel, 1.0f);
+	}
+	// Sliding beyond the skin rebuilds the points
+	b.set_position(glm::vec3{ 0.25f, 1.0f, 0.1f });
+	r = sat{ &pair, skin }.test_collision();
+	ASSERT_TRUE(r.m_contact);
+	pair.add_manifold(r.m_manifold);
+	ASSERT_FALSE(pair.manifold.points.empty());
+	for (const contact_point& p : pair.manifold.points)
+		ASSERT_EQ(p.lambda_Vel, 0.0f);
+	// Separating beyond the skin loses the contact
+	b.set_position(glm::vec3{ 0.2f, 1.05f, 0.1f });
+	r = sat{ &pair, skin }.test_collision();
+	ASSERT_FALSE(r.m_contact);
+}
+
+TEST(overlap_pair, update_depths)
+{
+	// Create resting pair
+	body a;
+	a.set_static(true);
+	body b;
+	b.set_mass(1.0f);
+	b.set_inertia(glm::mat3{ 1.0f / 6.0f });
+	b.set_position(glm::vec3{ 0.0f, 1.0f, 0.0f });
+	overlap_pair pair{ &a, &b, nullptr, nullptr };
+	pair.manifold.normal = { 0,1,0 };
+	for (float x : { -0.5f, 0.5f })
+		pair.manifold.points.push_back(contact_point{ glm::vec3(x, 0.5f, 0.0f), glm::vec3(x, -0.5f, 0.0f) });
+	pair.update();
+	const float invM_Vel = pair.manifold.points[0].invM_Vel;
+	// Sink and tilt the box without running the narrowphase
+	b.set_position(glm::vec3{ 0.0f, 0.9f, 0.0f });
+	b.set_rotation(glm::angleAxis(0.1f, glm::vec3{ 0.0f, 0.0f, 1.0f }));
+	pair.update_depths();
+	// Test the depths follow the points, the constraint data is kept
+	for (const contact_point& p : pair.manifold.points)
+		ASSERT_NEAR(p.depth, 0.5f - p.point_B.y, 0.0001f);
+	ASSERT_GT(pair.manifold.points[0].depth, pair.manifold.points[1].depth);
+	ASSERT_EQ(pair.manifold.points[0].invM_Vel, invM_Vel);
+}
+
+TEST(hull_cache, matches_uncached_sat)
+{
+	physical_mesh cube = make_unit_cube();
+	// Create static body A and dynamic body B
+	body a;
+	a.set_static(true);
+	body b;
+	struct config { glm::quat m_rot_A; glm::quat m_rot_B; glm::vec3 m_pos_B; };
+	const glm::vec3 x{ 1.0f, 0.0f, 0.0f }, y{ 0.0f, 1.0f, 0.0f }, z{ 0.0f, 0.0f, 1.0f };
+	const config configs[]{
+		// Resting on a face
+		{ glm::angleAxis(0.3f, y), glm::angleAxis(0.2f, glm::normalize(x + z)), glm::vec3{ 0.1f, 0.95f, -0.05f } },
+		// Crossing edges
+		{ glm::angleAxis(glm::quarter_pi<float>(), x), glm::angleAxis(glm::quarter_pi<float>(), z), glm::vec3{ 0.0f, 1.38f, 0.0f } }
+	};
+	for (const config& c : configs)
+	{
+		a.set_rotation(c.m_rot_A);
+		b.set_rotation(c.m_rot_B);
+		b.set_position(c.m_pos_B);
+		// Same pair with and without the shared caches
+		overlap_pair uncached{ &a, &b, &cube, &cube };
+		overlap_pair cached{ &a, &b, &cube, &cube };
+		hull_cache cache_A, cache_B;
+		cache_A.build(cube, a);
+		cache_B.build(cube, b);
+		const sat::result r0 = sat{ &uncached, 0.05f }.test_collision();
+		const sat::result r1 = sat{ &cached, 0.05f, &cache_A, &cache_B }.test_collision();
+		// Test the penetration data matches
+		ASSERT_TRUE(r0.m_contact);
+		ASSERT_EQ(r0.m_contact, r1.m_contact);
+		ASSERT_EQ(uncached.prev_data.m_actor, cached.prev_data.m_actor);
+		ASSERT_EQ(uncached.prev_data.m_face_index, cached.prev_data.m_face_index);
+		ASSERT_EQ(uncached.prev_data.m_edgeA, cached.prev_data.m_edgeA);
+		ASSERT_EQ(uncached.prev_data.m_edgeB, cached.prev_data.m_edgeB);
+		ASSERT_NEAR(uncached.prev_data.m_penetration, cached.prev_data.m_penetration, 0.0001f);
+		// Test the manifold matches
+		ASSERT_NEAR(glm::length(r0.m_manifold.m_normal - r1.m_manifold.m_normal), 0.0f, 0.0001f);
+		ASSERT_EQ(r0.m_manifold.m_local_A.size(), r1.m_manifold.m_local_A.size());
+		for (size_t i = 0; i < r0.m_manifold.m_local_A.size(); ++i)
+		{
+			ASSERT_NEAR(glm::length(r0.m_manifold.m_local_A[i] - r1.m_manifold.m_local_A[i]), 0.0f, 0.0001f);
+			ASSERT_NEAR(glm::length(r0.m_manifold.m_local_B[i] - r1.m_manifold.m_local_B[i]), 0.0f, 0.0001f);
+		}
+	}
+}
+
+TEST(body, interpolated_model)
+{
+	// Moving body, teleported to a known pose
+	body b;
+	b.set_mass(1.0f);
+	b.set_inertia(glm::mat3{ 1.0f / 6.0f });
+	b.set_position(glm::vec3{ 0.0f, 1.0f, 0.0f });
+	ASSERT_EQ(b.get_interpolated_model(0.0f), b.get_model());
+	// One step to the right
+	b.add_impulse_linear(glm::vec3{ 60.0f, 0.0f, 0.0f });
+	b.store_pose();
+	b.integrate_positions(1.0f / 60.0f);
+	// Test the pose blends between the two states
+	ASSERT_NEAR(b.get_interpolated_model(0.0f)[3].x, 0.0f, 0.0001f);
+	ASSERT_NEAR(b.get_interpolated_model(0.5f)[3].x, 0.5f, 0.0001f);
+	ASSERT_NEAR(b.get_interpolated_model(1.0f)[3].x, 1.0f, 0.0001f);
+	ASSERT_NEAR(b.get_interpolated_model(0.5f)[3].y, 1.0f, 0.0001f);
+}
+
+#include <physics/body_soa.h>
+#include <physics/thread_pool.h>
+TEST(body_soa, matches_body_integration)
+{
+	// Spinning bodies with their own damping, some static or sleeping, not a whole number of registers
+	std::vector<body> bodies(37u);
+	std::vector<float> steps(bodies.size(), 1.0f / 60.0f);
+	for (uint i = 0; i < bodies.size(); ++i)
+	{
+		body& b = bodies[i];
+		const float f = static_cast<float>(i);
+		b.set_mass(1.0f + 0.1f * f);
+		b.set_inertia(glm::mat3{ 1.0f / 6.0f + 0.01f * f });
+		b.set_rotation(glm::normalize(glm::quat{ 1.0f, 0.1f * f, -0.05f * f, 0.02f * f }));
+		b.m_linear_momentum = { f, -0.5f * f, 2.0f };
+		b.m_angular_momentum = { 0.3f * f, 1.0f, -0.2f * f };
+		b.m_linear_damping = 0.01f * static_cast<float>(i % 5u);
+		b.m_is_static = i % 7u == 3u;
+		b.m_is_sleeping = i % 11u == 5u;
+		steps[i] *= 1.0f - 0.01f * static_cast<float>(i % 3u);
+	}
+	// Integrate one copy body by body and another one by registers, then again to reuse the damping
+	std::vector<body> expected = bodies;
+	thread_pool pool{ 3u };
+	body_soa soa;
+	for (int run = 0; run < 2; ++run)
+	{
+		for (uint i = 0; i < expected.size(); ++i)
+		{
+			expected[i].integrate_velocities(1.0f / 60.0f, { 0.0f, -10.0f, 0.0f });
+			expected[i].integrate_positions(steps[i]);
+		}
+		soa.integrate_velocities(bodies, 1.0f / 60.0f, { 0.0f, -10.0f, 0.0f }, run == 0 ? nullptr : &pool);
+		soa.integrate_positions(bodies, steps, run == 0 ? nullptr : &pool);
+	}
+	for (uint i = 0; i < bodies.size(); ++i)
+		for (int c = 0; c < 3; ++c)
+		{
+			ASSERT_NEAR(bodies[i].m_linear_momentum[c], expected[i].m_linear_momentum[c], 1e-5f);
+			ASSERT_NEAR(bodies[i].m_angular_momentum[c], expected[i].m_angular_momentum[c], 1e-5f);
+			ASSERT_NEAR(bodies[i].m_position[c], expected[i].m_position[c], 1e-5f);
+			ASSERT_NEAR(bodies[i].m_rotation[c], expected[i].m_rotation[c], 1e-6f);
+		}
+}
+
+#include <physics/island.h>
+TEST(island, merge_and_sleep)
+{
+	// Two islands: {0,1,2} and {3}
+	island_graph islands;
+	islands.reset(4);
+	islands.merge(2, 1);
+	islands.merge(1, 0);
+	ASSERT_EQ(islands.find(2), 0u);
+	ASSERT_EQ(islands.find(1), 0u);
+	ASSERT_EQ(islands.find(3), 3u);
+	// Still bodies accumulate sleep time, moving ones reset it
+	body b;
+	b.set_mass(1.0f);
+	b.set_inertia(glm::mat3{ 1.0f / 6.0f });
+	b.update_sleep_time(0.25f);
+	b.update_sleep_time(0.25f);
+	ASSERT_NEAR(b.m_sleep_time, 0.5f, 0.0001f);
+	b.put_to_sleep();
+	// Impulses wake the body
+	b.add_impulse_linear({ 0.0f, 1.0f, 0.0f });
+	ASSERT_FALSE(b.m_is_sleeping);
+	b.update_sleep_time(0.25f);
+	ASSERT_EQ(b.m_sleep_time, 0.0f);
+}
+
+#include <physics/body_removal.h>
+TEST(body_removal, wakes_resting_stack)
+{
+	// Sleeping stack on the static floor: 0 <- 1 <- 2 <- 3
+	std::vector<body> bodies(4);
+	std::vector<physical_mesh> meshes;
+	for (uint i = 0; i < bodies.size(); ++i)
+		meshes.push_back(make_unit_cube());
+	bodies[0].set_static(true);
+	for (uint i = 1; i < bodies.size(); ++i)
+	{
+		bodies[i].set_mass(1.0f).set_inertia(glm::mat3{ 1.0f / 6.0f }).set_position({ 0.0f, static_cast<float>(i), 0.0f });
+		bodies[i].put_to_sleep();
+	}
+	broadphase tree;
+	std::vector<uint> proxies;
+	for (uint i = 0; i < bodies.size(); ++i)
+		proxies.push_back(tree.add_proxy(meshes[i].get_aabb(bodies[i].get_model()), i));
+	// Remove the box on the floor, the top one takes its place
+	swap_remove_body(1u, bodies, meshes, proxies, tree);
+	ASSERT_EQ(bodies.size(), 3u);
+	ASSERT_EQ(proxies.size(), 3u);
+	ASSERT_EQ(tree.get_user(proxies[1]), 1u);
+	ASSERT_EQ(bodies[1].m_position.y, 3.0f);
+	// Only the box resting on it is woken, the top one wakes with their island
+	ASSERT_FALSE(bodies[2].m_is_sleeping);
+	ASSERT_TRUE(bodies[1].m_is_sleeping);
+	island_graph islands;
+	islands.reset(static_cast<uint>(bodies.size()));
+	islands.merge(1, 2);
+	islands.wake_islands(bodies);
+	ASSERT_FALSE(bodies[1].m_is_sleeping);
+	// Nothing holds the stack anymore
+	for (int step = 0; step < 10; ++step)
+		for (body& b : bodies)
+		{
+			b.integrate_velocities(physics_dt, { 0.0f, -10.0f, 0.0f });
+			b.integrate_positions(physics_dt);
+		}
+	ASSERT_LT(bodies[1].m_position.y, 3.0f);
+	ASSERT_LT(bodies[2].m_position.y, 2.0f);
+}
+
+#include <physics/slot_map.h>
+TEST(slot_map, swap_remove_and_stale_handles)
+{
+	slot_map slots;
+	std::vector<slot_handle> handles;
+	for (uint i = 0; i < 5u; ++i)
+		handles.push_back(slots.insert());
+	for (uint i = 0; i < 5u; ++i)
+		ASSERT_EQ(slots.find(handles[i]), i);
+	// The last element moves into the hole
+	ASSERT_EQ(slots.erase(handles[1]), 1u);
+	ASSERT_EQ(slots.size(), 4u);
+	ASSERT_EQ(slots.find(handles[4]), 1u);
+	ASSERT_TRUE(slots.get_handle(1u) == handles[4]);
+	// Removed handles stay stale after their slot is reused
+	ASSERT_EQ(slots.find(handles[1]), UINT_MAX);
+	ASSERT_EQ(slots.erase(handles[1]), UINT_MAX);
+	const slot_handle reused = slots.insert();
+	ASSERT_EQ(reused.m_slot, handles[1].m_slot);
+	ASSERT_EQ(slots.find(reused), 4u);
+	ASSERT_EQ(slots.find(handles[1]), UINT_MAX);
+	// Clearing frees every handle, slots are handed from the first one again
+	slots.clear();
+	ASSERT_EQ(slots.size(), 0u);
+	ASSERT_EQ(slots.find(handles[0]), UINT_MAX);
+	ASSERT_EQ(slots.insert().m_slot, 0u);
+}
+
+#include <physics/broadphase.h>
+#include <physics/math_utils.h>
+#include <set>
+TEST(broadphase, incremental_pairs)
+{
+	// Unit boxes scattered in a cube
+	const uint count{ 300u };
+	std::vector<aabb> boxes(count);
+	for (uint i = 0; i < count; ++i)
+	{
+		const glm::vec3 center{ rand(-10.0f, 10.0f), rand(-10.0f, 10.0f), rand(-10.0f, 10.0f) };
+		boxes[i].add_point(center - glm::vec3{ 0.5f });
+		boxes[i].add_point(center + glm::vec3{ 0.5f });
+	}
+	broadphase tree;
+	std::vector<uint> proxies;
+	for (uint i = 0; i < count; ++i)
+		proxies.push_back(tree.add_proxy(boxes[i], i));
+	// Pairs overlapping with the fat boxes, lowest user first
+	std::vector<bool> alive(count, true);
+	auto brute_force = [&]()
+	{
+		std::set<std::pair<uint, uint>> pairs;
+		for (uint i = 0; i < count; ++i)
+			for (uint j = i + 1; j < count; ++j)
+				if (alive[i] && alive[j] && tree.get_box(proxies[i]).overlaps(tree.get_box(proxies[j])))
+					pairs.insert({ i, j });
+		return pairs;
+	};
+	auto reported = [&]()
+	{
+		std::vector<std::pair<uint, uint>> new_pairs;
+		tree.update_pairs(new_pairs);
+		std::set<std::pair<uint, uint>> pairs;
+		for (auto p : new_pairs)
+			pairs.insert({ glm::min(p.first, p.second), glm::max(p.first, p.second) });
+		// Every pair is reported once
+		EXPECT_EQ(pairs.size(), new_pairs.size());
+		return pairs;
+	};
+	// Every proxy is new
+	ASSERT_EQ(reported(), brute_force());
+	ASSERT_LT(tree.get_height(), 20u);
+	// Nothing moved
+	ASSERT_TRUE(reported().empty());
+	// Motion inside the fat box keeps the proxy
+	aabb nudged = boxes[0];
+	nudged.m_min.x += 0.05f;
+	nudged.m_max.x += 0.05f;
+	ASSERT_FALSE(tree.move_proxy(proxies[0], nudged));
+	// Remove half and move the rest, all the overlaps are new
+	for (uint i = 0; i < count; i += 2u)
+	{
+		tree.remove_proxy(proxies[i]);
+		alive[i] = false;
+	}
+	for (uint i = 1; i < count; i += 2u)
+	{
+		boxes[i].m_min.y += 3.0f;
+		boxes[i].m_max.y += 3.0f;
+		ASSERT_TRUE(tree.move_proxy(proxies[i], boxes[i]));
+	}
+	ASSERT_EQ(reported(), brute_force());
+	// Proxies added again reuse the freed nodes
+	for (uint i = 0; i < count; i += 2u)
+	{
+		proxies[i] = tree.add_proxy(boxes[i], i);
+		alive[i] = true;
+	}
+	const std::set<std::pair<uint, uint>> pairs = reported();
+	for (auto p : brute_force())
+	{
+		if (p.first % 2u == 0u || p.second % 2u == 0u)
+		{
+			ASSERT_TRUE(pairs.count(p));
+		}
+	}
+}
+
+#include <physics/thread_pool.h>
+TEST(thread_pool, parallel_for)
+{
+	// Force workers even on single core machines
+	thread_pool pool{ 3u };
+	ASSERT_EQ(pool.get_thread_count(), 4u);
+	// Every index is visited once, each thread writes its own sum
+	std::vector<uint> visits(1000u, 0u);
+	std::vector<uint> sums(pool.get_thread_count(), 0u);
+	for (int run = 0; run < 10; ++run)
+		pool.parallel_for(1000u, 7u, [&](uint begin, uint end, uint thread)
+		{
+			for (uint i = begin; i < end; ++i)
+			{
+				++visits[i];
+				sums[thread] += i;
+			}
+		});
+	for (uint v : visits)
+		ASSERT_EQ(v, 10u);
+	ASSERT_EQ(std::accumulate(sums.begin(), sums.end(), 0u), 10u * 999u * 1000u / 2u);
+}
+
+TEST(thread_pool, task_graph)
+{
+	thread_pool pool{ 3u };
+	// Diamond: 0 -> {1, 2} -> 3, the middle tasks run nested loops
+	std::atomic<uint> clock{ 0u };
+	std::vector<uint> order(4u, 0u);
+	std::vector<uint> visits(1000u, 0u);
+	task_graph graph;
+	const uint first = graph.add([&](uint) { order[0] = clock++; });
+	const uint left = graph.add([&](uint)
+	{
+		order[1] = clock++;
+		pool.parallel_for(500u, 7u, [&](uint begin, uint end, uint) { for (uint i = begin; i < end; ++i) ++visits[i]; });
+	});
+	const uint right = graph.add([&](uint)
+	{
+		order[2] = clock++;
+		pool.parallel_for(500u, 7u, [&](uint begin, uint end, uint) { for (uint i = begin; i < end; ++i) ++visits[500u + i]; });
+	});
+	const uint last = graph.add([&](uint) { order[3] = clock++; });
+	graph.precede(first, left);
+	graph.precede(first, right);
+	graph.precede(left, last);
+	graph.precede(right, last);
+	// The same graph can run again
+	for (int run = 0; run < 10; ++run)
+	{
+		pool.run(graph);
+		ASSERT_LT(order[0], glm::min(order[1], order[2]));
+		ASSERT_GT(order[3], glm::max(order[1], order[2]));
+	}
+	for (uint v : visits)
+		ASSERT_EQ(v, 10u);
+}
+
+#include <chrono>
+#include <ctime>
+TEST(thread_pool, wait_sleeps)
+{
+	thread_pool pool{ 1u };
+	// Too many workers are clamped
+	ASSERT_EQ(thread_pool{ 1000u }.get_thread_count(), thread_pool::c_max_workers + 1u);
+	// The caller finishes its half first and waits for the worker sleeping in the other
+	std::atomic<bool> started{ false };
+	const std::clock_t cpu = std::clock();
+	pool.parallel_for(2u, 1u, [&](uint, uint, uint thread)
+	{
+		if (thread == 0u)
+		{
+			while (!started)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			return;
+		}
+		started = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	});
+	// Waiting does not burn the core
+	ASSERT_LT(static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC, 0.05);
+}
+
+#include <physics/triple_buffer.h>
+TEST(triple_buffer, latest_and_consistent)
+{
+	// Reader gets the last published slot, and keeps it until a new one
+	triple_buffer<std::vector<uint>> buffer;
+	ASSERT_TRUE(buffer.front().empty());
+	for (uint i = 1u; i <= 3u; ++i)
+	{
+		buffer.back().assign(4u, i);
+		buffer.publish();
+	}
+	ASSERT_EQ(buffer.front(), std::vector<uint>(4u, 3u));
+	ASSERT_EQ(buffer.front(), std::vector<uint>(4u, 3u));
+	// A writer thread never tears the slot the reader holds
+	std::atomic<bool> done{ false };
+	std::thread writer{ [&]()
+	{
+		for (uint i = 4u; i < 20000u; ++i)
+		{
+			buffer.back().assign(4u, i);
+			buffer.publish();
+		}
+		done = true;
+	} };
+	uint last{ 3u };
+	uint errors{ 0u };
+	while (!done)
+	{
+		const std::vector<uint>& v = buffer.front();
+		if (v != std::vector<uint>(4u, v[0]) || v[0] < last)
+			++errors;
+		last = v[0];
+	}
+	writer.join();
+	ASSERT_EQ(errors, 0u);
+	ASSERT_EQ(buffer.front(), std::vector<uint>(4u, 19999u));
+}
+
+TEST(constraint_solver, parallel_matches_serial)
+{
+	// Two identical stacks falling on a static body
+	const size_t count = 9;
+	std::vector<body> bodies[2];
+	std::vector<overlap_pair> pair[2];
+	std::vector<overlap_pair *> pairs[2];
+	for (int s = 0; s < 2; ++s)
+	{
+		bodies[s].resize(count);
+		bodies[s][0].set_static(true);
+		for (size_t i = 1; i < count; ++i)
+		{
+			body& b = bodies[s][i];
+			b.set_mass(1.0f);
+			b.set_inertia(glm::mat3{ 1.0f / 6.0f });
+			b.set_position(glm::vec3{ 0, 0.5f + (i - 1), 0 });
+			b.m_linear_momentum = { 0, -0.1f * i, 0 };
+		}
+		for (size_t i = 1; i < count; ++i)
+		{
+			pair[s].push_back(overlap_pair{ &bodies[s][i - 1], &bodies[s][i], nullptr, nullptr });
+			pair[s].back().manifold.normal = { 0,1,0 };
+			pair[s].back().manifold.points.push_back(contact_point{ glm::vec3(0.0f, i == 1 ? 0.0 : 0.5, 0.0f), glm::vec3(0.0f, -0.5f, 0.0f) });
+			pair[s].back().update();
+		}
+		for (auto& p : pair[s])
+			pairs[s].push_back(&p);
+	}
+	// Solve serial & colored
+	thread_pool pool{ 3u };
+	constraint_contact_solver{ 256, 0.0f }.evaluate(pairs[0]);
+	constraint_contact_solver{ 256, 0.0f, false, &pool }.evaluate(pairs[1]);
+	// Test both converge to the same solution
+	for (size_t i = 0; i < count; ++i)
+		ASSERT_NEAR(glm::length(bodies[0][i].m_linear_momentum - bodies[1][i].m_linear_momentum), 0.0f, 0.01f);
+	for (size_t i = 0; i < pair[0].size(); ++i)
+		ASSERT_NEAR(pair[0][i].manifold.points[0].lambda_Vel, pair[1][i].manifold.points[0].lambda_Vel, 0.01f);
+}
+
+TEST(constraint_solver, islands_match_serial)
+{
+	// Two separated piles, solved together and as parallel islands
+	const size_t count = 7;
+	std::vector<body> bodies[2];
+	std::vector<overlap_pair> pair[2];
+	for (int s = 0; s < 2; ++s)
+	{
+		bodies[s].resize(2 * count);
+		for (size_t pile = 0; pile < 2; ++pile)
+		{
+			const size_t first = pile * count;
+			bodies[s][first].set_static(true);
+			for (size_t i = 1; i < count; ++i)
+			{
+				body& b = bodies[s][first + i];
+				b.set_mass(1.0f + pile);
+				b.set_inertia(glm::mat3{ (1.0f + pile) / 6.0f });
+				b.set_position(glm::vec3{ 10.0f * pile, 0.5f + (i - 1), 0 });
+				b.m_linear_momentum = { 0.05f * i, -0.1f * i * (1.0f + pile), 0 };
+				b.m_angular_momentum = { 0.0f, 0.02f * i, 0.01f * pile };
+			}
+		}
+		// Contacts of both piles interleaved
+		for (size_t i = 1; i < count; ++i)
+			for (size_t pile = 0; pile < 2; ++pile)
+			{
+				const size_t first = pile * count;
+				pair[s].push_back(overlap_pair{ &bodies[s][first + i - 1], &bodies[s][first + i], nullptr, nullptr });
+				pair[s].back().manifold.normal = { 0,1,0 };
+				for (float x : { -0.5f, 0.5f })
+					pair[s].back().manifold.points.push_back(contact_point{ glm::vec3(x, i == 1 ? 0.0 : 0.5, 0.0f), glm::vec3(x, -0.5f, 0.0f) });
+				pair[s].back().update();
+			}
+	}
+	// Solve every contact at once
+	std::vector<overlap_pair *> all;
+	for (auto& p : pair[0])
+		all.push_back(&p);
+	constraint_contact_solver{ 16, 0.2f }.evaluate(all);
+	// Solve each pile as an island task
+	std::vector<overlap_pair *> islands[2];
+	for (size_t i = 0; i < pair[1].size(); ++i)
+		islands[i % 2].push_back(&pair[1][i]);
+	thread_pool pool{ 2u };
+	pool.parallel_for(2u, 1u, [&](uint begin, uint end, uint)
+	{
+		for (uint i = begin; i < end; ++i)
+			constraint_contact_solver{ 16, 0.2f }.evaluate(islands[i]);
+	});
+	// Test islands that share no body give the same result bit for bit
+	for (size_t i = 0; i < bodies[0].size(); ++i)
+	{
+		ASSERT_EQ(bodies[0][i].m_linear_momentum, bodies[1][i].m_linear_momentum);
+		ASSERT_EQ(bodies[0][i].m_angular_momentum, bodies[1][i].m_angular_momentum);
+	}
+	for (size_t i = 0; i < pair[0].size(); ++i)
+		for (size_t j = 0; j < pair[0][i].manifold.points.size(); ++j)
+			ASSERT_EQ(pair[0][i].manifold.points[j].lambda_Vel, pair[1][i].manifold.points[j].lambda_Vel);
+}
+
+TEST(overlap_pair, parallel_prestep_matches_serial)
+{
+	// Moving bodies touching their neighbours in a row
+	const uint count = 200u;
+	std::vector<body> bodies(count);
+	bodies[0].set_static(true);
+	for (uint i = 1; i < count; ++i)
+	{
+		body& b = bodies[i];
+		b.set_mass(1.0f + 0.01f * i);
+		b.set_inertia(glm::mat3{ glm::vec3{ 1.0f, 0.0f, 0.0f }, glm::vec3{ 0.0f, 2.0f, 0.0f }, glm::vec3{ 0.0f, 0.0f, 3.0f } });
+		b.set_rotation(glm::normalize(glm::quat{ glm::vec3{ 0.01f * i, 0.3f, -0.02f * i } }));
+		b.set_position({ 1.0f * i, 0.5f, 0.0f });
+		b.set_roll(0.1f);
+		b.m_linear_momentum = { 0.1f * (i % 7u), -1.0f, 0.05f * (i % 3u) };
+		b.m_angular_momentum = { 0.0f, 0.1f * (i % 5u), 0.0f };
+	}
+	std::vector<overlap_pair> pair[2];
+	std::vector<overlap_pair *> pairs[2];
+	for (int s = 0; s < 2; ++s)
+	{
+		for (uint i = 1; i < count; ++i)
+		{
+			pair[s].push_back(overlap_pair{ &bodies[i - 1], &bodies[i], nullptr, nullptr });
+			pair[s].back().manifold.normal = glm::normalize(glm::vec3{ 1.0f, 0.1f * (i % 4u), 0.0f });
+			for (float y : { -0.4f, 0.4f })
+				pair[s].back().manifold.points.push_back(contact_point{ glm::vec3(0.5f, y, 0.1f), glm::vec3(-0.5f, y, -0.1f) });
+		}
+		for (auto& p : pair[s])
+			pairs[s].push_back(&p);
+	}
+	// Serial update against the parallel prestep
+	for (overlap_pair* p : pairs[0])
+		p->update();
+	thread_pool pool{ 3u };
+	prestep_pairs(pairs[1], true, physics_dt, &pool);
+	// Test the constraint data matches bit for bit
+	for (uint i = 0; i < pair[0].size(); ++i)
+	{
+		const contact_manifold& a = pair[0][i].manifold;
+		const contact_manifold& b = pair[1][i].manifold;
+		for (uint j = 0; j < a.points.size(); ++j)
+		{
+			ASSERT_EQ(a.points[j].invM_Vel, b.points[j].invM_Vel);
+			ASSERT_EQ(a.points[j].restitution_bias, b.points[j].restitution_bias);
+			ASSERT_EQ(a.points[j].depth, b.points[j].depth);
+		}
+		ASSERT_EQ(a.vec_U, b.vec_U);
+		ASSERT_EQ(a.vec_V, b.vec_V);
+		ASSERT_EQ(a.invM_U, b.invM_U);
+		ASSERT_EQ(a.invM_V, b.invM_V);
+		ASSERT_EQ(a.invM_Twist, b.invM_Twist);
+		ASSERT_EQ(a.invM_Roll, b.invM_Roll);
+	}
+}
+
+TEST(constraint_solver, untouched_momentum)
+{
+	// Rotated body moving away from a static one
+	std::vector<body> bodies(2);
+	bodies[0].set_static(true);
+	bodies[1].set_mass(2.0f);
+	bodies[1].set_inertia(glm::mat3{ glm::vec3{ 1.0f, 0.0f, 0.0f }, glm::vec3{ 0.0f, 2.0f, 0.0f }, glm::vec3{ 0.0f, 0.0f, 3.0f } });
+	bodies[1].set_rotation(glm::normalize(glm::quat{ glm::vec3{ 0.3f, 0.7f, 0.2f } }));
+	bodies[1].set_position({ 0.0f, 2.0f, 0.0f });
+	bodies[1].m_linear_momentum = { 0.2f, 1.0f, -0.4f };
+	bodies[1].m_angular_momentum = { 0.3f, -0.1f, 0.5f };
+	const glm::vec3 linear = bodies[1].m_linear_momentum;
+	const glm::vec3 angular = bodies[1].m_angular_momentum;
+	std::vector<overlap_pair> pair{ overlap_pair{ &bodies[0], &bodies[1], nullptr, nullptr } };
+	pair[0].manifold.normal = { 0,1,0 };
+	pair[0].manifold.points.push_back(contact_point{ glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, -0.5f, 0.0f) });
+	pair[0].update();
+	std::vector<overlap_pair *> pairs{ &pair[0] };
+	// No impulse is needed, the momentum goes through the solver unchanged
+	constraint_contact_solver{ 8, 0.0f }.evaluate(pairs);
+	ASSERT_NEAR(pair[0].manifold.points[0].lambda_Vel, 0.0f, 1e-6f);
+	ASSERT_NEAR(glm::length(bodies[1].m_linear_momentum - linear), 0.0f, 1e-5f);
+	ASSERT_NEAR(glm::length(bodies[1].m_angular_momentum - angular), 0.0f, 1e-5f);
+	ASSERT_EQ(bodies[0].m_linear_momentum, glm::vec3(0.0f));
+}
+
+TEST(constraint_solver, block_single_iteration)
+{
+	// Tilted box landing on a static one with four contact points
+	body bodies[2];
+	bodies[0].set_static(true);
+	bodies[1].set_mass(1.0f);
+	bodies[1].set_inertia(glm::mat3{ 1.0f / 6.0f });
+	bodies[1].set_restitution(0.0f);
+	bodies[1].set_position({ 0.0f, 1.0f, 0.0f });
+	bodies[1].m_linear_momentum = { 0.0f, -1.0f, 0.0f };
+	bodies[1].m_angular_momentum = { 0.05f, 0.0f, -0.02f };
+	overlap_pair pair{ &bodies[0], &bodies[1], nullptr, nullptr };
+	pair.manifold.normal = { 0,1,0 };
+	for (glm::vec2 c : { glm::vec2{ -0.5f, -0.5f }, glm::vec2{ 0.5f, -0.5f }, glm::vec2{ 0.5f, 0.5f }, glm::vec2{ -0.5f, 0.5f } })
+		pair.manifold.points.push_back(contact_point{ glm::vec3(c.x, 0.5f, c.y), glm::vec3(c.x, -0.5f, c.y) });
+	pair.update();
+	std::vector<overlap_pair *> pairs{ &pair };
+	// A single block iteration solves every point at once: no point
+	// approaches and the ones that push do not separate either
+	constraint_contact_solver{ 1, 0.0f, false, nullptr, false, true }.evaluate(pairs);
+	for (const contact_point& p : pair.manifold.points)
+	{
+		const float velocity = glm::dot(bodies[1].get_velocity_at_point(p.point_B), pair.manifold.normal);
+		ASSERT_GE(p.lambda_Vel, 0.0f);
+		ASSERT_GE(velocity, -0.01f);
+		if (p.lambda_Vel > 0.0f)
+		{
+			ASSERT_NEAR(velocity, 0.0f, 0.01f);
+		}
+	}
+}
+
+TEST(constraint_solver, wide_block_uses_block)
+{
+	// Same tilted landing solved by the block solver, with and without wide
+	body bodies[2][2];
+	overlap_pair pair[2];
+	for (int s = 0; s < 2; ++s)
+	{
+		bodies[s][0].set_static(true);
+		bodies[s][1].set_mass(1.0f);
+		bodies[s][1].set_inertia(glm::mat3{ 1.0f / 6.0f });
+		bodies[s][1].set_position({ 0.0f, 1.0f, 0.0f });
+		bodies[s][1].m_linear_momentum = { 0.1f, -1.0f, 0.0f };
+		bodies[s][1].m_angular_momentum = { 0.05f, 0.0f, -0.02f };
+		pair[s] = overlap_pair{ &bodies[s][0], &bodies[s][1], nullptr, nullptr };
+		pair[s].manifold.normal = { 0,1,0 };
+		for (glm::vec2 c : { glm::vec2{ -0.5f, -0.5f }, glm::vec2{ 0.5f, -0.5f }, glm::vec2{ 0.5f, 0.5f }, glm::vec2{ -0.5f, 0.5f } })
+			pair[s].manifold.points.push_back(contact_point{ glm::vec3(c.x, 0.5f, c.y), glm::vec3(c.x, -0.5f, c.y) });
+		pair[s].update();
+	}
+	std::vector<overlap_pair *> pairs[2]{ { &pair[0] }, { &pair[1] } };
+	constraint_contact_solver{ 4, 0.0f, false, nullptr, false, true }.evaluate(pairs[0]);
+	constraint_contact_solver{ 4, 0.0f, false, nullptr, true, true }.evaluate(pairs[1]);
+	// Test the wide flag does not drop the block solve
+	ASSERT_EQ(bodies[0][1].m_linear_momentum, bodies[1][1].m_linear_momentum);
+	ASSERT_EQ(bodies[0][1].m_angular_momentum, bodies[1][1].m_angular_momentum);
+	for (size_t i = 0; i < pair[0].manifold.points.size(); ++i)
+		ASSERT_EQ(pair[0].manifold.points[i].lambda_Vel, pair[1].manifold.points[i].lambda_Vel);
+}
+
+TEST(constraint_solver, wide_matches_colored)
+{
+	// Two identical stacks of spinning boxes falling on a static body
+	const size_t count = 13;
+	std::vector<body> bodies[2];
+	std::vector<overlap_pair> pair[2];
+	std::vector<overlap_pair *> pairs[2];
+	for (int s = 0; s < 2; ++s)
+	{
+		bodies[s].resize(count);
+		bodies[s][0].set_static(true);
+		for (size_t i = 1; i < count; ++i)
+		{
+			body& b = bodies[s][i];
+			b.set_mass(1.0f);
+			b.set_inertia(glm::mat3{ 1.0f / 6.0f });
+			b.set_friction(0.5f);
+			b.set_position(glm::vec3{ 0, 0.5f + (i - 1), 0 });
+			b.m_linear_momentum = { 0.05f * i, -0.1f * i, 0 };
+			b.m_angular_momentum = { 0, 0.01f * i, 0 };
+		}
+		for (size_t i = 1; i < count; ++i)
+		{
+			pair[s].push_back(overlap_pair{ &bodies[s][i - 1], &bodies[s][i], nullptr, nullptr });
+			pair[s].back().manifold.normal = { 0,1,0 };
+			for (float x : { -0.5f, 0.5f })
+				pair[s].back().manifold.points.push_back(contact_point{ glm::vec3(x, i == 1 ? 0.0f : 0.5f, x), glm::vec3(x, -0.5f, x) });
+			pair[s].back().update();
+		}
+		for (auto& p : pair[s])
+			pairs[s].push_back(&p);
+	}
+	// Solve colored & wide, both visit the pairs in the same order
+	thread_pool pool{ 3u };
+	constraint_contact_solver{ 256, 0.0f, false, &pool }.evaluate(pairs[0]);
+	constraint_contact_solver{ 256, 0.0f, false, nullptr, true }.evaluate(pairs[1]);
+	// Test both converge to the same solution
+	for (size_t i = 0; i < count; ++i)
+	{
+		ASSERT_NEAR(glm::length(bodies[0][i].m_linear_momentum - bodies[1][i].m_linear_momentum), 0.0f, 0.001f);
+		ASSERT_NEAR(glm::length(bodies[0][i].m_angular_momentum - bodies[1][i].m_angular_momentum), 0.0f, 0.001f);
+	}
+	for (size_t i = 0; i < pair[0].size(); ++i)
+	{
+		ASSERT_NEAR(pair[0][i].manifold.points[1].lambda_Vel, pair[1][i].manifold.points[1].lambda_Vel, 0.001f);
+		ASSERT_NEAR(pair[0][i].manifold.lambda_U, pair[1][i].manifold.lambda_U, 0.001f);
+	}
+}
+
+TEST(constraint_solver, split_impulse)
+{
+	// Resting box sunk into a static one
+	const float depth = 0.1f;
+	body a;
+	a.set_static(true);
+	body b;
+	b.set_restitution(0.0f);
+	b.set_mass(1.0f);
+	b.set_inertia(glm::mat3{ 1.0f / 6.0f });
+	b.set_position(glm::vec3{ 0, 0.5f - depth, 0 });
+	overlap_pair pair{ &a, &b, nullptr, nullptr };
+	pair.manifold.normal = { 0,1,0 };
+	for (float x : { -0.5f, 0.5f })
+		pair.manifold.points.push_back(contact_point{ glm::vec3(x, 0.0f, x), glm::vec3(x, -0.5f, x) });
+	pair.update();
+	std::vector<overlap_pair *> pairs{ &pair };
+	// Solve with a position pass
+	constraint_contact_solver{ 8, 0.2f, false, nullptr, false, false, 4 }.evaluate(pairs);
+	// Test the box moved out without gaining any velocity
+	ASSERT_GT(b.m_position.y, 0.5f - depth);
+	ASSERT_NEAR(glm::length(b.get_linear_velocity()), 0.0f, 0.0001f);
+	ASSERT_NEAR(glm::length(b.get_angular_velocity()), 0.0f, 0.0001f);
+	// The same setup with Baumgarte only pushes through the velocity
+	b.set_position(glm::vec3{ 0, 0.5f - depth, 0 });
+	constraint_contact_solver{ 8, 0.2f }.evaluate(pairs);
+	ASSERT_GT(b.get_linear_velocity().y, 0.0f);
+}
+
+TEST(constraint_solver, tolerance_stops_early)
+{
+	// Box landing flat on a static one
+	body bodies[2];
+	bodies[0].set_static(true);
+	bodies[1].set_mass(1.0f);
+	bodies[1].set_inertia(glm::mat3{ 1.0f / 6.0f });
+	bodies[1].set_restitution(0.0f);
+	bodies[1].set_position({ 0.0f, 1.0f, 0.0f });
+	bodies[1].m_linear_momentum = { 0.0f, -1.0f, 0.0f };
+	overlap_pair pair{ &bodies[0], &bodies[1], nullptr, nullptr };
+	pair.manifold.normal = { 0,1,0 };
+	for (glm::vec2 c : { glm::vec2{ -0.5f, -0.5f }, glm::vec2{ 0.5f, -0.5f }, glm::vec2{ 0.5f, 0.5f }, glm::vec2{ -0.5f, 0.5f } })
+		pair.manifold.points.push_back(contact_point{ glm::vec3(c.x, 0.5f, c.y), glm::vec3(c.x, -0.5f, c.y) });
+	pair.update();
+	std::vector<overlap_pair *> pairs{ &pair };
+	// Solve with a tolerance and a high cap
+	constraint_contact_solver solver{ 100, 0.0f, false, nullptr, false, false, 0, false, 0.0001f };
+	solver.evaluate(pairs);
+	// Test it stopped once converged, keeping a residual per iteration
+	ASSERT_LT(solver.m_residuals.size(), 100u);
+	ASSERT_LT(solver.m_residuals.back(), 0.0001f);
+	ASSERT_GT(solver.m_residuals.front(), solver.m_residuals.back());
+	ASSERT_NEAR(bodies[1].get_linear_velocity().y, 0.0f, 0.01f);
+}
+
+TEST(constraint_solver, shock_propagation)
+{
+	// Stack of boxes landing on a static one, touching at their centers
+	const size_t count = 11;
+	std::vector<body> bodies(count);
+	bodies[0].set_static(true);
+	for (size_t i = 1; i < count; ++i)
+	{
+		bodies[i].set_mass(1.0f);
+		bodies[i].set_inertia(glm::mat3{ 1.0f / 6.0f });
+		bodies[i].set_restitution(0.0f);
+		bodies[i].set_position(glm::vec3{ 0, 0.5f + (i - 1), 0 });
+		bodies[i].m_linear_momentum = { 0, -1.0f, 0 };
+	}
+	// Pairs from the top down, the worst order for a single iteration
+	std::vector<overlap_pair> pair;
+	pair.reserve(count - 1);
+	for (size_t i = count - 1; i > 0; --i)
+	{
+		pair.push_back(overlap_pair{ &bodies[i - 1], &bodies[i], nullptr, nullptr });
+		pair.back().manifold.normal = { 0,1,0 };
+		pair.back().manifold.points.push_back(contact_point{ glm::vec3(0.0f, i == 1 ? 0.0f : 0.5f, 0.0f), glm::vec3(0.0f, -0.5f, 0.0f) });
+		pair.back().update();
+	}
+	std::vector<overlap_pair *> pairs;
+	for (auto& p : pair)
+		pairs.push_back(&p);
+	// A single iteration followed by the shock pass
+	constraint_contact_solver{ 1, 0.0f, false, nullptr, false, false, 0, false, 0.0f, glm::vec3{ 0, 1, 0 } }.evaluate(pairs);
+	// Test the whole stack stopped
+	for (size_t i = 1; i < count; ++i)
+		ASSERT_NEAR(bodies[i].get_linear_velocity().y, 0.0f, 0.001f);
+	// Without the pass the top keeps falling
+	for (size_t i = 1; i < count; ++i)
+		bodies[i].m_linear_momentum = { 0, -1.0f, 0 };
+	for (auto& p : pair)
+		p.manifold.points[0].lambda_Vel = 0.0f;
+	constraint_contact_solver{ 1, 0.0f }.evaluate(pairs);
+	ASSERT_LT(bodies[count - 1].get_linear_velocity().y, -0.1f);
+}
+
+TEST(constraint_solver, mass_splitting)
+{
+	// Two identical stacks of spinning boxes falling on a static body
+	const size_t count = 13;
+	std::vector<body> bodies[2];
+	std::vector<overlap_pair> pair[2];
+	std::vector<overlap_pair *> pairs[2];
+	for (int s = 0; s < 2; ++s)
+	{
+		bodies[s].resize(count);
+		bodies[s][0].set_static(true);
+		for (size_t i = 1; i < count; ++i)
+		{
+			body& b = bodies[s][i];
+			b.set_mass(1.0f);
+			b.set_inertia(glm::mat3{ 1.0f / 6.0f });
+			b.set_friction(0.5f);
+			b.set_restitution(0.0f);
+			b.set_position(glm::vec3{ 0, 0.5f + (i - 1), 0 });
+			b.m_linear_momentum = { 0.05f * i, -0.1f * i, 0 };
+			b.m_angular_momentum = { 0, 0.01f * i, 0 };
+		}
+		for (size_t i = 1; i < count; ++i)
+		{
+			pair[s].push_back(overlap_pair{ &bodies[s][i - 1], &bodies[s][i], nullptr, nullptr });
+			pair[s].back().manifold.normal = { 0,1,0 };
+			for (float x : { -0.5f, 0.5f })
+				pair[s].back().manifold.points.push_back(contact_point{ glm::vec3(x, i == 1 ? 0.0f : 0.5f, x), glm::vec3(x, -0.5f, x) });
+			pair[s].back().update();
+		}
+		for (auto& p : pair[s])
+			pairs[s].push_back(&p);
+	}
+	// Solve with and without threads, Jacobi needs many more iterations on a stack
+	thread_pool pool{ 3u };
+	constraint_contact_solver{ 4096, 0.0f, false, nullptr, false, false, 0, false, 0.0f, glm::vec3{ 0.0f }, true }.evaluate(pairs[0]);
+	constraint_contact_solver{ 4096, 0.0f, false, &pool, false, false, 0, false, 0.0f, glm::vec3{ 0.0f }, true }.evaluate(pairs[1]);
+	// Test the threads do not change the result, and no box approaches the one below
+	for (size_t i = 0; i < count; ++i)
+	{
+		ASSERT_TRUE(bodies[0][i].m_linear_momentum == bodies[1][i].m_linear_momentum);
+		ASSERT_TRUE(bodies[0][i].m_angular_momentum == bodies[1][i].m_angular_momentum);
+	}
+	for (const overlap_pair& p : pair[0])
+	for (const contact_point& c : p.manifold.points)
+	{
+		const float velocity = glm::dot(p.body_B->get_velocity_at_point(c.point_B) - p.body_A->get_velocity_at_point(c.point_A), p.manifold.normal);
+		ASSERT_GE(velocity, -0.01f);
+	}
+	// Test the manifolds keep the real masses
+	ASSERT_EQ(pair[0][1].manifold.invM_A, 1.0f);
+}
@@ -15,6 +15,7 @@
 #include <imgui/imgui_impl_opengl3.h>
 #include <imgui/ImGuizmo.h>
 #include "window.h" // !window define
+#include <functional>
 
 bool c_editor::imgui_initialize()const
 {
@@ -126,20 +127,91 @@ void c_editor::create_scene() const
 		physics.add_body("cube.obj").set_position({ 8.0f, 1.0f, 0.0f }).set_static(true);
 		physics.add_body("cube.obj").set_position({ 9.0f, 1.91f, 0.0f }).set_static(true).set_rotation(glm::normalize(glm::quat{ glm::vec3{0.5f*glm::half_pi<float>(), -0.5f*glm::half_pi<float>(), 0.0f} }));
 		break;
+
+	case 7:
+	{
+		// Create wavy terrain as static triangle geometry
+		const int cells{ 38 };
+		std::vector<glm::vec3> vertices;
+		std::vector<uint> indices;
+		for (int z = 0; z <= cells; ++z)
+			for (int x = 0; x <= cells; ++x)
+				vertices.push_back({ x - cells * 0.5f, 1.0f + 0.75f * glm::sin(x * 0.4f) * glm::cos(z * 0.4f), z - cells * 0.5f });
+		for (int z = 0; z < cells; ++z)
+			for (int x = 0; x < cells; ++x)
+			{
+				const uint a = z * (cells + 1) + x;
+				const uint b = a + 1;
+				const uint c = a + cells + 2;
+				const uint d = a + cells + 1;
+				indices.insert(indices.end(), { a, d, c, a, c, b });
+			}
+		physics.add_static_mesh(vertices, indices).set_friction(m_floor_friction).set_restitution(m_floor_restitution);
+		// Drop cubes & spheres on it
+		for (uint i = 0; i < 30u; ++i)
+			physics.add_body((i % 2 == 0) ? "cube.obj" : "sphere.obj")
+			.set_position({ rand(-8.f, 8.f), rand(3.f, 12.f), rand(-8.f, 8.f) })
+			.set_friction(m_general_friction)
+			.set_restitution(m_general_restitution);
+		break;
+	}
+
+	case 8:
+	{
+		// Create hilly terrain as a heightfield
+		const uint samples{ 161u };
+		const float cell{ 0.25f };
+		std::vector<float> heights;
+		for (uint z = 0; z < samples; ++z)
+			for (uint x = 0; x < samples; ++x)
+				heights.push_back(0.75f + 0.6f * glm::sin(x * cell * 0.3f) * glm::sin(z * cell * 0.25f) + 0.25f * glm::cos((x + z) * cell * 0.7f));
+		physics.add_heightfield(samples, samples, cell, heights)
+			.set_position({ -20.0f, 0.0f, -20.0f })
+			.set_friction(m_floor_friction)
+			.set_restitution(m_floor_restitution);
+		// Drop cubes & spheres on it
+		for (uint i = 0; i < 40u; ++i)
+			physics.add_body((i % 2 == 0) ? "cube.obj" : "sphere.obj")
+			.set_position({ rand(-15.f, 15.f), rand(3.f, 12.f), rand(-15.f, 15.f) })
+			.set_friction(m_general_friction)
+			.set_restitution(m_general_restitution);
+		break;
+	}
 	}
 }
+/**
+ * Expects the world to be locked
+**/
 void c_editor::reset_scene()
 {
 	// Clearn objects
 	physics.clean();
 	// Creat new scene
 	create_scene();
+	// Do not draw the old bodies with the new meshes
+	physics.publish();
+	// Reset picking
+	m_hovered = -1;
+	m_selected = -1;
+}
+/**
+ * Expects the world to be locked
+**/
+void c_editor::remove_selected()
+{
+	// The last body takes its place
+	physics.remove_body(physics.get_handle(physics.m_bodies[m_selected]));
+	// Do not draw the bodies with the meshes they had before
+	physics.publish();
 	// Reset picking
 	m_hovered = -1;
 	m_selected = -1;
 }
 void c_editor::draw_debug_bodies()const
 {
+	// Latest state of the physics thread
+	const physics_snapshot& snapshot = physics.m_snapshots.front();
+	const float t = snapshot.get_interpolation();
 	// Draw wireframe
 	if (m_wireframe)
 	{
@@ -157,17 +229,18 @@ void c_editor::draw_debug_bodies()const
 		}
 	}
 	// Draw bodies
-	for (uint i = 0; i < physics.m_bodies.size(); i++)
+	for (uint i = 0; i < snapshot.m_bodies.size(); i++)
 	{
-		const physical_mesh& mesh = physics.m_meshes[i];
+		// Geometry published with the body, the live meshes may change meanwhile
+		const debug_shape& mesh = *snapshot.m_shapes[i];
 		// Get render lines
-		std::vector<glm::vec3> lines = mesh.get_lines();
+		std::vector<glm::vec3> lines = mesh.m_lines;
 		// Ger render triangles
 		std::pair<std::vector<glm::vec3>,
-			std::vector<glm::vec3> > tri = mesh.get_triangles();
-		// Get model matrix
-		const body& bdy = physics.m_bodies[i];
-		glm::mat4 m = bdy.get_model();
+			std::vector<glm::vec3> > tri{ mesh.m_points, mesh.m_normals };
+		// Get model matrix between the last two steps
+		const body& bdy = snapshot.m_bodies[i];
+		glm::mat4 m = bdy.get_interpolated_model(t);
 		// Update lines
 		for (auto& p : lines)
 			p = tr_point(m, p);
@@ -176,7 +249,7 @@ void c_editor::draw_debug_bodies()const
 			tri.first[j] = tr_point(m, tri.first[j]),
 			tri.second[j] = tr_vector(m, tri.second[j]);
 		// Select color
-		glm::vec3 color = ((uint)m_hovered == i) ? cyan : black;
+		glm::vec3 color = ((uint)m_hovered == i) ? cyan : (bdy.m_is_sleeping ? blue : black);
 		// Add lines to drawlist
 		drawer.add_debugline_list(lines, color);
 		// Add triangles to drawlist
@@ -189,6 +262,31 @@ void c_editor::draw_debug_bodies()const
 			drawer.add_debugline(bdy.m_position, bdy.m_position + bdy.m_angular_momentum, blue);
 		}
 	}
+	// Draw contact points
+	for (const debug_contact& c : snapshot.m_contacts)
+	{
+		drawer.add_debugline(c.m_point_A, c.m_point_B, red);
+		drawer.add_debugline_cube(c.m_point_A, 0.1f, red);
+		drawer.add_debugline_cube(c.m_point_B, 0.1f, blue);
+		drawer.add_debugline(c.m_point_A, c.m_point_A + c.m_penetration, green);
+	}
+	// Draw triangle meshes and heightfields, big terrains can be hidden
+	if (!m_draw_static_geometry)
+		return;
+	for (uint i = 0; i < snapshot.m_static_shapes.size(); i++)
+	{
+		// Ger render triangles
+		const debug_shape& mesh = *snapshot.m_static_shapes[i];
+		std::pair<std::vector<glm::vec3>,
+			std::vector<glm::vec3> > tri{ mesh.m_points, mesh.m_normals };
+		// Update triangles
+		const glm::mat4& m = snapshot.m_static_models[i];
+		for (uint j = 0; j < tri.first.size(); ++j)
+			tri.first[j] = tr_point(m, tri.first[j]),
+			tri.second[j] = tr_vector(m, tri.second[j]);
+		// Add triangles to drawlist
+		drawer.add_debugtri_list(tri.first, tri.second, white);
+	}
 }
 void c_editor::object_picking()
 {
@@ -199,8 +297,8 @@ void c_editor::object_picking()
 	ray mouse_ray{ mouse_pos, glm::normalize(mouse_pos - drawer.m_camera.m_eye) };
 	// Raycast scene
 	ray_info_detailed info = physics.ray_cast(mouse_ray);
-	// If intersected
-	if (info.m_intersected)
+	// If intersected a body (static geometry is not selectable)
+	if (info.m_intersected && !info.m_static_geometry)
 	{
 		body& b = physics.m_bodies[info.m_body];
 		// Draw normal
@@ -220,6 +318,7 @@ void c_editor::object_picking()
 				if (input.is_key_down(GLFW_KEY_LEFT_SHIFT))
 					force *= 0.01f;
 				b.add_impulse_angular(glm::cross(info.m_pi - b.m_position, force));
+				b.wake_up();
 			}
 			else
 				m_selected = m_hovered;
@@ -248,6 +347,8 @@ void c_editor::update()
 {
 	// Call the bodies to be drawn
 	draw_debug_bodies();
+	// Picking and resetting touch the world the physics thread is stepping
+	std::lock_guard<std::mutex> lock{ physics.m_world_mutex };
 	// If not hovering guizmo
 	if (!ImGuizmo::IsOver())
 	{
@@ -257,21 +358,61 @@ void c_editor::update()
 		// Check reset trigger
 		if (input.is_key_triggered(GLFW_KEY_R))
 			reset_scene();
+		// Check delete trigger
+		if (input.is_key_triggered(GLFW_KEY_DELETE) && m_selected >= 0)
+			remove_selected();
 		// Check wireframe trigger
 		if (input.is_key_triggered(GLFW_KEY_F1))
 			m_wireframe = !m_wireframe;
+		// Check static geometry trigger
+		if (input.is_key_triggered(GLFW_KEY_F2))
+			m_draw_static_geometry = !m_draw_static_geometry;
 	}
 }
+/**
+ * Widgets of the solver settings, returns true if any changed
+**/
+bool c_editor::draw_solver_settings(physics_settings& settings)
+{
+	bool changed{ false };
+	changed |= ImGui::SliderInt("Solver Iterations", &settings.m_solver_iterations, 1, 100);
+	changed |= ImGui::SliderInt("Substeps", &settings.m_substeps, 1, 16);
+	changed |= ImGui::SliderFloat("Solver Tolerance", &settings.m_solver_tolerance, 0.0f, 0.1f, "%.4f");
+	changed |= ImGui::SliderFloat("Baumgarte Value", &settings.m_baumgarte, 0.0f, 1.0f);
+	changed |= ImGui::Checkbox("Do Warm Start", &settings.m_do_warm_start);
+	changed |= ImGui::Checkbox("Parallel Solver", &settings.m_parallel_solver);
+	changed |= ImGui::Checkbox("Wide Solver", &settings.m_wide_solver);
+	changed |= ImGui::Checkbox("Block Solver", &settings.m_block_solver);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Solves the normal impulses of a manifold at once.\nTowers of 10-20 boxes only rest at the default\nBaumgarte value with Split Impulse on as well.");
+	changed |= ImGui::Checkbox("Mass Splitting", &settings.m_mass_splitting);
+	changed |= ImGui::Checkbox("Split Impulse", &settings.m_split_impulse);
+	if (settings.m_split_impulse)
+		changed |= ImGui::SliderInt("Position Iterations", &settings.m_position_iterations, 1, 20);
+	changed |= ImGui::Checkbox("Shock Propagation", &settings.m_shock_propagation);
+	changed |= ImGui::Checkbox("Speculative Contacts", &settings.m_speculative_contacts);
+	changed |= ImGui::SliderFloat("Contact Margin", &settings.m_contact_margin, 0.0f, 0.1f);
+	changed |= ImGui::Checkbox("Contact Reuse", &settings.m_contact_reuse);
+	changed |= ImGui::Checkbox("Sleeping", &settings.m_sleeping);
+	changed |= ImGui::SliderInt("Contact Reuse Frames", &settings.m_contact_reuse_frames, 1, 20);
+	return changed;
+}
 void c_editor::drawGui()
 {
 	// Setup render imgui
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
+	// Widgets show the last published state, the world is only locked to apply the edits
+	const physics_snapshot& snapshot = physics.m_snapshots.front();
+	std::vector<std::function<void(body&)>> body_edits;
+	physics_settings settings = *this;
+	bool settings_changed{ false };
+	bool reset{ false };
 	// If selected -> Render body window
-	if (m_selected >= 0)
+	if (m_selected >= 0 && m_selected < static_cast<int>(snapshot.m_bodies.size()))
 	{
-		body& b = physics.m_bodies[m_selected];
+		body b = snapshot.m_bodies[m_selected];
 		if (ImGui::Begin("Body", nullptr))
 		{
 			// Render ImGuizmo
@@ -294,30 +435,49 @@ void c_editor::drawGui()
 			float matrixTranslation[3], matrixRotation[3], matrixScale[3];
 			ImGuizmo::DecomposeMatrixToComponents(&model[0][0], matrixTranslation, matrixRotation, matrixScale);
 			glm::vec3 eu_angles{ matrixRotation[0], matrixRotation[1], matrixRotation[2] };
-			switch (m_operation)
+			// Dragging the guizmo pulls or rotates the body and wakes it
+			if (ImGuizmo::IsUsing())
 			{
-			case ImGuizmo::TRANSLATE:
-				glm::vec3 goal{ matrixTranslation[0], matrixTranslation[1], matrixTranslation[2] };
-				b.m_linear_momentum += (goal - b.m_position)*0.2f;
-				break;
-			case ImGuizmo::ROTATE:
-				b.set_rotation(glm::normalize(glm::quat{ glm::radians(eu_angles) }));
-				break;
+				switch (m_operation)
+				{
+				case ImGuizmo::TRANSLATE:
+				{
+					const glm::vec3 goal{ matrixTranslation[0], matrixTranslation[1], matrixTranslation[2] };
+					const glm::vec3 impulse = (goal - b.m_position)*0.2f;
+					body_edits.push_back([impulse](body& live) { live.m_linear_momentum += impulse; live.wake_up(); });
+					break;
+				}
+				case ImGuizmo::ROTATE:
+				{
+					const glm::quat rotation = glm::normalize(glm::quat{ glm::radians(eu_angles) });
+					body_edits.push_back([rotation](body& live) { live.set_rotation(rotation); });
+					break;
+				}
+				default:
+					break;
+				}
 			}
 
 			// Display body properties
-			ImGui::DragFloat3("Position", &b.m_position.x, 0.01f);
+			if (ImGui::DragFloat3("Position", &b.m_position.x, 0.01f))
+				body_edits.push_back([position = b.m_position](body& live) { live.m_position = position; live.wake_up(); });
 			if (ImGui::InputFloat4("Rotation", &b.m_rotation.x))
-				b.m_rotation = glm::normalize(b.m_rotation);
+				body_edits.push_back([rotation = b.m_rotation](body& live) { live.set_rotation(glm::normalize(rotation)); });
 			if (ImGui::Button("StopMovement"))
-				b.clear_momentum();
+				body_edits.push_back([](body& live) { live.clear_momentum(); });
 			ImGui::SameLine();
 			if (ImGui::RadioButton("Is Static", b.m_is_static))
-				b.set_static(!b.m_is_static);
+				body_edits.push_back([](body& live) { live.set_static(!live.m_is_static); });
+			ImGui::SameLine();
+			if (ImGui::Checkbox("CCD", &b.m_ccd))
+				body_edits.push_back([ccd = b.m_ccd](body& live) { live.m_ccd = ccd; });
 			ImGui::NewLine();
-			ImGui::InputFloat3("Linear M", &b.m_linear_momentum.x);
-			ImGui::InputFloat3("Angular M", &b.m_angular_momentum.x);
-			ImGui::InputFloat("Mass", &b.m_inv_mass);
+			if (ImGui::InputFloat3("Linear M", &b.m_linear_momentum.x))
+				body_edits.push_back([momentum = b.m_linear_momentum](body& live) { live.m_linear_momentum = momentum; });
+			if (ImGui::InputFloat3("Angular M", &b.m_angular_momentum.x))
+				body_edits.push_back([momentum = b.m_angular_momentum](body& live) { live.m_angular_momentum = momentum; });
+			if (ImGui::InputFloat("Mass", &b.m_inv_mass))
+				body_edits.push_back([inv_mass = b.m_inv_mass](body& live) { live.m_inv_mass = inv_mass; });
 			ImGui::NewLine();
 			glm::mat3 i = glm::inverse(b.m_inv_inertia);
 			ImGui::InputFloat3("Inertia", &i[0].x);
@@ -336,7 +496,7 @@ void c_editor::drawGui()
 			m_floor_restitution = 0.2f;
 			m_general_friction = 0.0f;
 			m_general_restitution = 0.2f;
-			reset_scene();
+			reset = true;
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Scene 1"))
@@ -347,7 +507,7 @@ void c_editor::drawGui()
 			m_general_friction = 0.3f;
 			m_general_restitution = 0.2f;
 			m_general_impulse = 30.0f;
-			reset_scene();
+			reset = true;
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Scene 2"))
@@ -358,7 +518,7 @@ void c_editor::drawGui()
 			m_general_friction = 1.0f;
 			m_general_restitution = 0.2f;
 			m_general_impulse = 2.5f;
-			reset_scene();
+			reset = true;
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Scene 3"))
@@ -370,7 +530,7 @@ void c_editor::drawGui()
 			m_general_restitution = 0.2f;
 			m_general_roll = 0.1f;
 			m_general_impulse = 2.5f;
-			reset_scene();
+			reset = true;
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Scene 4"))
@@ -380,7 +540,7 @@ void c_editor::drawGui()
 			m_floor_restitution = 0.0f;
 			m_general_friction = 0.3f;
 			m_general_restitution = 0.0f;
-			reset_scene();
+			reset = true;
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Scene 5"))
@@ -391,12 +551,32 @@ void c_editor::drawGui()
 			m_general_friction = 0.3f;
 			m_general_restitution = 0.2f;
 			m_general_roll = 0.025f;
-			reset_scene();
+			reset = true;
 		}
 		if (ImGui::Button("Scene 6"))
 		{
 			m_scene = 6;
-			reset_scene();
+			reset = true;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Scene 7"))
+		{
+			m_scene = 7;
+			m_floor_friction = 0.3f;
+			m_floor_restitution = 0.2f;
+			m_general_friction = 0.3f;
+			m_general_restitution = 0.2f;
+			reset = true;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Scene 8"))
+		{
+			m_scene = 8;
+			m_floor_friction = 0.3f;
+			m_floor_restitution = 0.2f;
+			m_general_friction = 0.3f;
+			m_general_restitution = 0.2f;
+			reset = true;
 		}
 		ImGui::NewLine();
 		ImGui::SliderFloat("Floor Friction", &m_floor_friction, 0.0f, 1.0f);
@@ -433,9 +613,7 @@ void c_editor::drawGui()
 			ImGui::SliderFloat("General Friction", &m_general_friction, 0.0f, 1.0f);
 			ImGui::SliderFloat("General Restitution", &m_general_restitution, 0.0f, 1.0f);
 			ImGui::NewLine();
-			ImGui::SliderInt("Solver Iterations", &m_solver_iterations, 1, 100);
-			ImGui::SliderFloat("Baumgarte Value", &m_baumgarte, 0.0f, 1.0f);
-			ImGui::Checkbox("Do Warm Start", &m_do_warm_start);
+			settings_changed |= draw_solver_settings(settings);
 			break;
 
 		case 5:
@@ -444,16 +622,34 @@ void c_editor::drawGui()
 			ImGui::SliderFloat("General Roll", &m_general_roll, 0.0f, 1.0f);
 			ImGui::SliderFloat("General Impulse", &m_general_impulse, 0.0f, 100.0f);
 			ImGui::NewLine();
-			ImGui::SliderInt("Solver Iterations", &m_solver_iterations, 1, 100);
-			ImGui::SliderFloat("Baumgarte Value", &m_baumgarte, 0.0f, 1.0f);
-			ImGui::Checkbox("Do Warm Start", &m_do_warm_start);
+			settings_changed |= draw_solver_settings(settings);
+			break;
+
 		default:
 			break;
 		}
 		ImGui::NewLine();
-		ImGui::Text(("FPS: " + std::to_string(1.0 / physics_dt) + " ( " + std::to_string(physics_dt)+ ")").c_str());
+		settings_changed |= ImGui::SliderInt("Physics Rate", &settings.m_physics_rate, 30, 240);
+		settings_changed |= ImGui::SliderInt("Max Steps Per Frame", &settings.m_max_steps, 1, 10);
+		ImGui::Checkbox("Draw Static Geometry", &m_draw_static_geometry);
+		ImGui::Text(("FPS: " + std::to_string(1.0 / window.m_dt) + " ( " + std::to_string(window.m_dt)+ ")").c_str());
+		// Biggest lambda change of each solver iteration last step
+		const std::vector<float>& convergence = snapshot.m_convergence;
+		ImGui::Text(("Solver Iterations Run: " + std::to_string(convergence.size())).c_str());
+		ImGui::PlotLines("Convergence", convergence.data(), static_cast<int>(convergence.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 80.0f));
 		ImGui::End();
 	}
+	// Apply the edits with the world locked
+	if (!body_edits.empty() || settings_changed || reset)
+	{
+		std::lock_guard<std::mutex> lock{ physics.m_world_mutex };
+		if (m_selected >= 0 && m_selected < static_cast<int>(physics.m_bodies.size()))
+			for (const auto& edit : body_edits)
+				edit(physics.m_bodies[m_selected]);
+		static_cast<physics_settings&>(*this) = settings;
+		if (reset)
+			reset_scene();
+	}
 	// Call to render imgui
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -7,7 +7,33 @@
 **/
 #pragma once
 
-class c_editor
+/**
+ * Settings read by the physics thread, only written with the world locked
+**/
+struct physics_settings
+{
+	int m_physics_rate{ 60 };
+	int m_max_steps{ 4 };
+	int m_solver_iterations{ 20 };
+	int m_substeps{ 1 };
+	float m_solver_tolerance{ 0.0f };
+	float m_baumgarte{ 0.05f };
+	bool m_do_warm_start{ true };
+	bool m_speculative_contacts{ true };
+	float m_contact_margin{ 0.02f };
+	bool m_contact_reuse{ true };
+	bool m_sleeping{ true };
+	bool m_parallel_solver{ true };
+	bool m_wide_solver{ false };
+	bool m_block_solver{ false };
+	bool m_mass_splitting{ false };
+	bool m_split_impulse{ false };
+	int m_position_iterations{ 4 };
+	bool m_shock_propagation{ false };
+	int m_contact_reuse_frames{ 4 };
+};
+
+class c_editor : public physics_settings
 {
 	int m_selected{ -1 };
 	int m_hovered{ -1 };
@@ -23,14 +49,14 @@ class c_editor
 	void imgui_shutdown()const;
 	void create_scene()const;
 	void reset_scene();
+	void remove_selected();
 	void draw_debug_bodies()const;
 	void object_picking();
+	static bool draw_solver_settings(physics_settings& settings);
 
 public:
-	int m_solver_iterations{ 20 };
-	float m_baumgarte{ 0.05f };
-	bool m_do_warm_start{ true };
 	bool m_wireframe{ false };
+	bool m_draw_static_geometry{ true };
 
 	bool initialize();
 	void update();
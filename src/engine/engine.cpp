@@ -22,6 +22,7 @@ bool engine::initialize()
 		return false;
 	if (!editor.initialize()) // Create scene
 		return false;
+	physics.start();	// Run physics on its own thread
 	return true;
 }
 
@@ -34,8 +35,7 @@ void engine::update()
 	{
 		// Update System
 		window.update();	// Update window
-		editor.update();	// Update editor
-		physics.update();	// Integrate physics
+		editor.update();	// Update editor, physics steps on its own thread
 
 		// Render Screen
 		drawer.render();	// Render primitives
@@ -50,6 +50,7 @@ void engine::update()
 **/
 void engine::shutdown()
 {
+	physics.stop();
 	editor.shutdown();
 	window.shutdown();
 }
@@ -6,12 +6,13 @@
  * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
 **/
 #include "physics.h"
-#include "drawer.h"
 #include "window.h"
 #include "editor.h"
 #include <physics/sat.h>
-#include <physics/contact_solver.h>
+#include <physics/sat_triangle.h>
+#include <physics/ccd.h>
 #include <physics/math_utils.h>
+#include <climits>
 
 /**
  * Perform ray instersection with the world
@@ -41,15 +42,63 @@ ray_info_detailed c_physics::ray_cast(const ray & world_ray)const
 			info.m_body = i;
 		}
 	}
+	for (uint i = 0; i < m_static_meshes.size(); i++)
+	{
+		glm::mat4 model = m_static_bodies[i].get_model();
+		glm::mat4 inv = glm::inverse(model);
+
+		// Create ray
+		ray local_ray = { tr_point(inv,world_ray.m_start),
+			tr_vector(inv,world_ray.m_direction) };
+
+		// Ray cast through the hierarchy
+		ray_info local_info = m_static_meshes[i].ray_cast(local_ray);
+
+		if (local_info.m_intersected && local_info.m_time < info.m_time)
+		{
+			info.m_intersected = true;
+			info.m_time = local_info.m_time;
+			info.m_normal = glm::mat3(model)*local_info.m_normal;
+
+			info.m_pi = world_ray.get_point(info.m_time);
+			info.m_static_geometry = true;
+		}
+	}
+	for (uint i = 0; i < m_heightfields.size(); i++)
+	{
+		glm::mat4 model = m_heightfield_bodies[i].get_model();
+		glm::mat4 inv = glm::inverse(model);
+
+		// Create ray
+		ray local_ray = { tr_point(inv,world_ray.m_start),
+			tr_vector(inv,world_ray.m_direction) };
+
+		// Ray cast walking the grid
+		ray_info local_info = m_heightfields[i].ray_cast(local_ray);
+
+		if (local_info.m_intersected && local_info.m_time < info.m_time)
+		{
+			info.m_intersected = true;
+			info.m_time = local_info.m_time;
+			info.m_normal = glm::mat3(model)*local_info.m_normal;
+
+			info.m_pi = world_ray.get_point(info.m_time);
+			info.m_static_geometry = true;
+		}
+	}
 	return info;
 }
 /**
  * Perform carrow collision detection of the pair
 **/
-bool c_physics::collision_narrow(overlap_pair * pair) const
+bool c_physics::collision_narrow(overlap_pair * pair, const hull_cache& cache_A, const hull_cache& cache_B, float dt) const
 {
+	// Keep last manifold if the pair barely moved since it was generated
+	if (editor.m_contact_reuse && pair->reuse_manifold(editor.m_contact_reuse_frames))
+		return true;
 	// Initialize algorithm
-	sat algorithm{ pair };
+	pair->margin = editor.m_contact_margin;
+	sat algorithm{ pair, contact_margin(*pair->body_A, *pair->body_B, dt), &cache_A, &cache_B };
 	// Run algorithm
 	sat::result r = algorithm.test_collision();
 	// If contact found
@@ -71,52 +120,673 @@ bool c_physics::collision_narrow(overlap_pair * pair) const
 		return false;
 	}
 }
+/**
+ * Compute how far apart a pair may be and still keep its contacts:
+ * the contact skin plus the gap it may close during this step
+**/
+float c_physics::contact_margin(const body & a, const body & b, float dt) const
+{
+	if (!editor.m_speculative_contacts)
+		return editor.m_contact_margin;
+	return editor.m_contact_margin + glm::length(b.get_linear_velocity() - a.get_linear_velocity()) * dt;
+}
+/**
+ * Perform narrow collision detection of a body against a static shape,
+ * testing only the triangles overlapping its bounding box
+**/
+template<typename T>
+void c_physics::collision_static(uint body_idx, uint shape_id, const T& shape, body* shape_body, float dt, std::map<static_key, overlap_pair>& next_overlaps)
+{
+	// Get hull data
+	body* bA = &m_bodies[body_idx];
+	const physical_mesh* mA = &m_meshes[body_idx];
+	// Get transformations
+	const glm::mat4 AtoW = bA->get_model();
+	const glm::mat4 AtoB = shape_body->get_invmodel() * AtoW;
+	const glm::mat4 BtoA = glm::inverse(AtoB);
+	// Query the triangles overlapping the hull, grown by the contact margin
+	const float margin = contact_margin(*bA, *shape_body, dt);
+	aabb box = mA->get_aabb(AtoB);
+	box.inflate(margin);
+	std::vector<uint> triangles;
+	shape.query(box, triangles);
+	for (uint t : triangles)
+	{
+		// Run algorithm
+		glm::vec3 tri[3];
+		shape.get_triangle(t, tri);
+		sat::result r = sat_triangle{ mA, AtoW, AtoB, BtoA, tri, margin }.test_collision();
+		if (!r.m_contact)
+			continue;
+		// Get mutual pair, reusing last frame data if any
+		const static_key key{ m_body_slots.get_handle(body_idx).m_slot, shape_id, t };
+		overlap_pair& pair = next_overlaps[key];
+		auto prev = m_static_overlaps.find(key);
+		if (prev != m_static_overlaps.end())
+			pair = prev->second;
+		pair.body_A = bA;
+		pair.body_B = shape_body;
+		pair.mesh_A = mA;
+		pair.mesh_B = nullptr;
+		pair.margin = editor.m_contact_margin;
+		// Add new manifold data
+		pair.add_manifold(r.m_manifold);
+		pair.m_state = overlap_pair::state::Collision;
+	}
+}
 
 /**
- * Update Manager
+ * Earliest time of impact of a body flagged for continuous collision
+ * against the rest of the world, culled by the box swept during the step
+**/
+float c_physics::time_of_impact(uint body_idx, float dt) const
+{
+	const body& bA = m_bodies[body_idx];
+	const physical_mesh& mA = m_meshes[body_idx];
+	// Box covering the motion of the body
+	aabb swept = mA.get_aabb(bA.get_model());
+	swept.add_box(mA.get_aabb(bA.get_predicted_model(dt)));
+	float toi = dt;
+	// Against the bodies whose proxies overlap the motion, they cover what
+	// the bodies were expected to move this step
+	std::vector<uint> proxies;
+	m_broadphase.query(swept, proxies);
+	for (uint p : proxies)
+	{
+		const uint i = m_broadphase.get_user(p);
+		if (i == body_idx)
+			continue;
+		const body& bB = m_bodies[i];
+		aabb other = m_meshes[i].get_aabb(bB.get_model());
+		other.add_box(m_meshes[i].get_aabb(bB.get_predicted_model(dt)));
+		if (!swept.overlaps(other))
+			continue;
+		toi = glm::min(toi, conservative_advancement{ bA, mA, bB, m_meshes[i] }.time_of_impact(toi));
+	}
+	// Against static geometry
+	for (uint s = 0; s < m_static_meshes.size(); ++s)
+		toi = time_of_impact_static(body_idx, m_static_meshes[s], m_static_bodies[s], swept, toi);
+	for (uint h = 0; h < m_heightfields.size(); ++h)
+		toi = time_of_impact_static(body_idx, m_heightfields[h], m_heightfield_bodies[h], swept, toi);
+	return toi;
+}
+/**
+ * Finishes the substep of a body stopped at its time of impact. Its contacts there
+ * are solved with the other bodies held still, then it moves the time left with the
+ * new velocity, stopping again if it would pass through something else.
+**/
+void c_physics::resolve_impact(uint body_idx, float dt)
+{
+	body& b = m_bodies[body_idx];
+	const physical_mesh& m = m_meshes[body_idx];
+	const float remaining = dt - m_steps[body_idx];
+	hull_cache cache;
+	cache.build(m, b);
+	// Other bodies near the impact, copied as static so only this one is solved
+	aabb box = m.get_aabb(b.get_model());
+	box.inflate(editor.m_contact_margin + glm::length(b.get_linear_velocity()) * remaining);
+	std::vector<uint> proxies;
+	m_broadphase.query(box, proxies);
+	std::vector<body> others;
+	std::vector<overlap_pair> pairs;
+	others.reserve(proxies.size());
+	pairs.reserve(proxies.size());
+	for (uint p : proxies)
+	{
+		const uint i = m_broadphase.get_user(p);
+		if (i == body_idx)
+			continue;
+		others.push_back(m_bodies[i]);
+		others.back().m_is_static = true;
+		hull_cache other;
+		other.build(m_meshes[i], others.back());
+		pairs.push_back({ &b, &others.back(), &m, &m_meshes[i] });
+		if (!collision_narrow(&pairs.back(), cache, other, remaining))
+			pairs.pop_back();
+	}
+	std::map<static_key, overlap_pair> static_pairs;
+	for (uint s = 0; s < m_static_meshes.size(); ++s)
+		collision_static(body_idx, m_static_mesh_ids[s], m_static_meshes[s], &m_static_bodies[s], remaining, static_pairs);
+	for (uint h = 0; h < m_heightfields.size(); ++h)
+		collision_static(body_idx, m_heightfield_ids[h], m_heightfields[h], &m_heightfield_bodies[h], remaining, static_pairs);
+	std::vector<overlap_pair*> contacts;
+	for (auto& pair : pairs)
+		contacts.push_back(&pair);
+	for (auto& it : static_pairs)
+		contacts.push_back(&it.second);
+	// Solve the impact and move the rest of the substep
+	prestep_pairs(contacts, true, remaining, nullptr);
+	make_solver(nullptr, false, remaining).evaluate(contacts);
+	b.integrate_positions(time_of_impact(body_idx, remaining));
+}
+/**
+ * Time of impact against the triangles of a static shape inside the swept box
+**/
+template<typename T>
+float c_physics::time_of_impact_static(uint body_idx, const T & shape, const body & shape_body, const aabb & swept, float toi) const
+{
+	// Bring the swept box into space of the shape
+	const aabb local = swept.transform(shape_body.get_invmodel());
+	std::vector<uint> triangles;
+	shape.query(local, triangles);
+	for (uint t : triangles)
+	{
+		glm::vec3 tri[3];
+		shape.get_triangle(t, tri);
+		toi = glm::min(toi, conservative_advancement{ m_bodies[body_idx], m_meshes[body_idx], shape_body, tri }.time_of_impact(toi));
+	}
+	return toi;
+}
+
+/**
+ * Update Manager, runs as many fixed steps as the frame time allows
 **/
 void c_physics::update()
 {
-	// Update physics delta time
-	physics_dt = static_cast<float>(window.m_dt);
+	// Simulate the window frame on the calling thread
+	simulate(window.m_dt);
+	publish();
+}
+
+/**
+ * Step the simulation on its own thread until stopped
+**/
+void c_physics::start()
+{
+	// Give the editor something to draw before the first step
+	publish();
+	m_running = true;
+	m_thread = std::thread{ &c_physics::run, this };
+}
+void c_physics::stop()
+{
+	m_running = false;
+	if (m_thread.joinable())
+		m_thread.join();
+}
+void c_physics::run()
+{
+	using clock = std::chrono::steady_clock;
+	clock::time_point last = clock::now();
+	while (m_running)
+	{
+		// Time since the last run
+		const clock::time_point now = clock::now();
+		const double frame_time = std::chrono::duration<double>(now - last).count();
+		last = now;
+		double wait{ 0.0 };
+		{
+			// Step and publish with the world locked
+			std::lock_guard<std::mutex> lock{ m_world_mutex };
+			simulate(frame_time);
+			publish();
+			wait = m_step_time - m_accumulator;
+		}
+		// Sleep until the next step is due
+		std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+	}
+}
+
+/**
+ * Run as many fixed steps as fit in the given time
+**/
+void c_physics::simulate(double frame_time)
+{
+	// Accumulate the frame time
+	m_step_time = 1.0 / static_cast<double>(glm::max(editor.m_physics_rate, 1));
+	m_accumulator += frame_time;
+	int steps{ 0 };
+	while (m_accumulator >= m_step_time && steps < editor.m_max_steps)
+	{
+		// Keep the last poses for interpolation
+		for (auto& b : m_bodies)
+			b.store_pose();
+		step(static_cast<float>(m_step_time));
+		m_accumulator -= m_step_time;
+		++steps;
+	}
+	// Drop the time a long frame could not catch up with instead of spiraling
+	m_accumulator = glm::min(m_accumulator, m_step_time);
+}
+
+/**
+ * Copy the state the editor and the drawer need into the next snapshot
+**/
+void c_physics::publish()
+{
+	physics_snapshot& snapshot = m_snapshots.back();
+	// Copy reusing the memory of the slot
+	snapshot.m_bodies.assign(m_bodies.begin(), m_bodies.end());
+	// Drawing geometry of the shapes added since the last publish
+	m_debug_shapes.resize(m_bodies.size());
+	for (uint i = 0; i < m_bodies.size(); ++i)
+	{
+		if (m_debug_shapes[i])
+			continue;
+		auto mesh = std::make_shared<debug_shape>();
+		mesh->m_lines = m_meshes[i].get_lines();
+		std::tie(mesh->m_points, mesh->m_normals) = m_meshes[i].get_triangles();
+		m_debug_shapes[i] = std::move(mesh);
+	}
+	// Static shapes are drawn by id
+	for (size_t i = m_static_debug_shapes.size(); i < m_static_shapes.size(); ++i)
+	{
+		const static_shape& shape = m_static_shapes[i];
+		auto mesh = std::make_shared<debug_shape>();
+		if (shape.m_heightfield)
+			std::tie(mesh->m_points, mesh->m_normals) = m_heightfields[shape.m_index].get_triangles();
+		else
+			std::tie(mesh->m_points, mesh->m_normals) = m_static_meshes[shape.m_index].get_triangles();
+		m_static_debug_shapes.push_back(std::move(mesh));
+	}
+	snapshot.m_shapes.assign(m_debug_shapes.begin(), m_debug_shapes.end());
+	snapshot.m_static_shapes.assign(m_static_debug_shapes.begin(), m_static_debug_shapes.end());
+	snapshot.m_static_models.clear();
+	for (uint id = 0; id < m_static_shapes.size(); ++id)
+		snapshot.m_static_models.push_back(get_static_body(id).get_model());
+	snapshot.m_convergence.assign(m_convergence.begin(), m_convergence.end());
+	// Contact points in world space
+	snapshot.m_contacts.clear();
+	for (auto o : m_contacts)
+	for (auto p : o->manifold.points)
+		snapshot.m_contacts.push_back({
+			tr_point(o->body_A->get_model(), p.local_A),
+			tr_point(o->body_B->get_model(), p.local_B),
+			o->manifold.normal * p.depth });
+	// Render between the last two steps
+	snapshot.m_interpolation = static_cast<float>(m_accumulator / m_step_time);
+	snapshot.m_step_time = m_step_time;
+	snapshot.m_time = std::chrono::steady_clock::now();
+	m_snapshots.publish();
+}
+
+/**
+ * Interpolation factor at the current time, advancing since the snapshot was published
+**/
+float physics_snapshot::get_interpolation() const
+{
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_time).count();
+	return glm::min(m_interpolation + static_cast<float>(elapsed / m_step_time), 1.0f);
+}
+
+/**
+ * Advance the simulation a fixed time step
+**/
+void c_physics::step(float dt)
+{
 	// Current contact information
-	std::vector<overlap_pair*> contacts;
-	// Integrate velocities
-	for (auto& b : m_bodies)
-		b.integrate_velocities(physics_dt, m_gravity);
-	// Detect collision
-	for (uint i = 0; i < m_bodies.size() - 1; ++i)
-		for (uint j = i + 1; j < m_bodies.size(); ++j)
-		{
-			// Get mutual pair
-			overlap_pair* pair = &m_overlaps[{i, j}];
-			// If new pair, initialize it properly
-			if (pair->m_state == overlap_pair::state::New)
-				*pair = { &m_bodies[i],&m_bodies[j],&m_meshes[i],&m_meshes[j] };
-			// Perform narrow collision detection
-			if (collision_narrow(pair))
+	std::vector<overlap_pair*>& contacts = m_contacts;
+	contacts.clear();
+	// Keep everything awake if sleeping is disabled
+	if (!editor.m_sleeping)
+		for (auto& b : m_bodies)
+			b.wake_up();
+	// Substeps share the collision detection of the whole step
+	const int substeps = glm::max(editor.m_substeps, 1);
+	const float substep_dt = dt / static_cast<float>(substeps);
+	// Collision detection stages, the ones not depending on each other run at the same time
+	m_hull_caches.resize(m_bodies.size());
+	std::map<static_key, overlap_pair> static_overlaps;
+	std::vector<std::map<static_key, overlap_pair>> thread_overlaps(m_pool.get_thread_count());
+	task_graph& graph = m_step_graph;
+	graph.clear();
+	// Integrate velocities of the first substep
+	const uint integrate = graph.add([&](uint) { m_body_soa.integrate_velocities(m_bodies, substep_dt, m_gravity, &m_pool); });
+	// Transform hulls into world space once, shared by all their pairs
+	const uint hulls = graph.add([this](uint)
+	{
+		m_pool.parallel_for(static_cast<uint>(m_bodies.size()), 16u, [this](uint begin, uint end, uint)
+		{
+			for (uint i = begin; i < end; ++i)
+				m_hull_caches[i].build(m_meshes[i], m_bodies[i]);
+		});
+	});
+	// Gather the pairs to test
+	const uint broadphase = graph.add([this, dt](uint) { update_broadphase(dt); });
+	// Detect collision, every pair only writes to itself
+	const uint narrowphase = graph.add([this, dt](uint)
+	{
+		m_pool.parallel_for(static_cast<uint>(m_candidates.size()), 32u, [this, dt](uint begin, uint end, uint)
+		{
+			for (uint c = begin; c < end; ++c)
 			{
-				// Update pair information
-				pair->update();
-				contacts.push_back(pair);
+				const narrow_candidate& cand = m_candidates[c];
+				collision_narrow(cand.m_pair, m_hull_caches[cand.m_body_A], m_hull_caches[cand.m_body_B], dt);
 			}
+		});
+	});
+	// Detect collision against static geometry
+	const uint narrowphase_static = graph.add([&](uint)
+	{
+		std::vector<uint> awake_bodies;
+		for (uint i = 0; i < m_bodies.size(); ++i)
+		{
+			if (m_bodies[i].m_is_static)
+				continue;
+			// Sleeping bodies keep their pairs, pointing them where the bodies are now
+			if (m_bodies[i].m_is_sleeping)
+			{
+				const uint slot = m_body_slots.get_handle(i).m_slot;
+				auto first = m_static_overlaps.lower_bound({ slot, 0u, 0u });
+				auto last = m_static_overlaps.lower_bound({ slot + 1u, 0u, 0u });
+				for (auto it = first; it != last; ++it)
+				{
+					it->second.body_A = &m_bodies[i];
+					it->second.mesh_A = &m_meshes[i];
+					it->second.body_B = &get_static_body(std::get<1>(it->first));
+				}
+				static_overlaps.insert(first, last);
+			}
+			else
+				awake_bodies.push_back(i);
 		}
-	// Solve velocity Contraints
-	constraint_contact_solver{editor.m_solver_iterations, editor.m_baumgarte, editor.m_do_warm_start}.evaluate(contacts);
-	// Draw debug contact points
-	for (auto o : contacts)
-	for (auto p : o->manifold.points)
+		// Each thread fills its own pairs, keys never repeat between bodies
+		if (!m_static_meshes.empty() || !m_heightfields.empty())
+			m_pool.parallel_for(static_cast<uint>(awake_bodies.size()), 4u, [&](uint begin, uint end, uint thread)
+			{
+				for (uint b = begin; b < end; ++b)
+				{
+					const uint i = awake_bodies[b];
+					for (uint s = 0; s < m_static_meshes.size(); ++s)
+						collision_static(i, m_static_mesh_ids[s], m_static_meshes[s], &m_static_bodies[s], dt, thread_overlaps[thread]);
+					for (uint h = 0; h < m_heightfields.size(); ++h)
+						collision_static(i, m_heightfield_ids[h], m_heightfields[h], &m_heightfield_bodies[h], dt, thread_overlaps[thread]);
+				}
+			});
+	});
+	// Group the touching bodies and gather their contacts
+	const uint islands = graph.add([&](uint)
+	{
+		// Merge, the map keeps them sorted whatever thread found them
+		for (auto& o : thread_overlaps)
+			static_overlaps.merge(o);
+		// Keep only the pairs touching this frame
+		m_static_overlaps.swap(static_overlaps);
+		// Wake the islands touched by an awake body
+		build_islands();
+		// Gather the contacts of awake islands
+		for (auto& it : m_overlaps)
+		{
+			overlap_pair& pair = it.second;
+			if (pair.m_state != overlap_pair::state::Collision)
+				continue;
+			if (!is_awake(*pair.body_A) && !is_awake(*pair.body_B))
+				continue;
+			contacts.push_back(&pair);
+		}
+		for (auto& it : m_static_overlaps)
+		{
+			overlap_pair& pair = it.second;
+			if (!is_awake(*pair.body_A))
+				continue;
+			contacts.push_back(&pair);
+		}
+	});
+	// Update pair information
+	const uint prestep = graph.add([&](uint) { prestep_contacts(contacts, true, dt); });
+	// Both narrowphases and the proxies need the new velocities for the speculative margins
+	graph.precede(integrate, broadphase);
+	graph.precede(integrate, narrowphase);
+	graph.precede(hulls, narrowphase);
+	graph.precede(broadphase, narrowphase);
+	graph.precede(integrate, narrowphase_static);
+	graph.precede(narrowphase, islands);
+	graph.precede(narrowphase_static, islands);
+	graph.precede(islands, prestep);
+	m_pool.run(graph);
+	// Each substep integrates and solves once, the contacts follow the bodies
+	m_convergence.clear();
+	for (int s = 0; s < substeps; ++s)
+	{
+		if (s > 0)
+		{
+			m_body_soa.integrate_velocities(m_bodies, substep_dt, m_gravity, &m_pool);
+			prestep_contacts(contacts, false, substep_dt);
+		}
+		// Solve velocity Contraints
+		solve_contacts(contacts, false, substep_dt);
+		// Integrate positions, bodies flagged for continuous collision stop at their time of impact
+		m_steps.assign(m_bodies.size(), substep_dt);
+		m_pool.parallel_for(static_cast<uint>(m_bodies.size()), 16u, [this, substep_dt](uint begin, uint end, uint)
+		{
+			for (uint i = begin; i < end; ++i)
+				if (m_bodies[i].m_ccd && is_awake(m_bodies[i]))
+					m_steps[i] = time_of_impact(i, substep_dt);
+		});
+		m_body_soa.integrate_positions(m_bodies, m_steps, &m_pool);
+		// The stopped bodies solve their impact and move the rest of the substep
+		for (uint i = 0; i < m_bodies.size(); ++i)
+			if (m_steps[i] < substep_dt)
+				resolve_impact(i, substep_dt);
+		// Remove the velocity the bias added to push the bodies apart
+		if (substeps > 1)
+		{
+			prestep_contacts(contacts, false, substep_dt);
+			solve_contacts(contacts, true, substep_dt);
+		}
+	}
+	// Put to sleep the islands that stayed still long enough
+	if (editor.m_sleeping)
+		update_sleeping(dt);
+}
+
+/**
+ * Move the proxies of the bodies that left their fat boxes, cache the new
+ * overlaps and drop the stale ones, gathering the pairs to test this step
+**/
+void c_physics::update_broadphase(float dt)
+{
+	// Boxes grown by the distance contacts are speculated at
+	const uint count = static_cast<uint>(m_bodies.size());
+	m_boxes.resize(count);
+	m_pool.parallel_for(count, 64u, [this, dt](uint begin, uint end, uint)
+	{
+		for (uint i = begin; i < end; ++i)
+		{
+			m_boxes[i] = m_meshes[i].get_aabb(m_bodies[i].get_model());
+			m_boxes[i].inflate(editor.m_contact_margin + glm::length(m_bodies[i].get_linear_velocity()) * dt);
+		}
+	});
+	// Bodies added since the last step get their proxies
+	for (uint i = 0; i < count; ++i)
+	{
+		if (m_proxies[i] == broadphase::c_null)
+			m_proxies[i] = m_broadphase.add_proxy(m_boxes[i], i);
+		else
+			m_broadphase.move_proxy(m_proxies[i], m_boxes[i]);
+	}
+	// Cache the new pairs, the first body is the one with the lowest handle
+	m_new_pairs.clear();
+	m_broadphase.update_pairs(m_new_pairs);
+	for (const auto& p : m_new_pairs)
+	{
+		pair_key key{ m_body_slots.get_handle(p.first), m_body_slots.get_handle(p.second) };
+		if (key.second < key.first)
+			std::swap(key.first, key.second);
+		m_overlaps.emplace(key, overlap_pair{});
+	}
+	// Bodies may have moved in the arrays since the last step
+	m_candidates.clear();
+	for (auto it = m_overlaps.begin(); it != m_overlaps.end();)
+	{
+		const uint i = m_body_slots.find(it->first.first);
+		const uint j = m_body_slots.find(it->first.second);
+		// Removed bodies and proxies that stopped overlapping end the pair
+		if (i == UINT_MAX || j == UINT_MAX || !m_broadphase.get_box(m_proxies[i]).overlaps(m_broadphase.get_box(m_proxies[j])))
+		{
+			it = m_overlaps.erase(it);
+			continue;
+		}
+		overlap_pair& pair = (it++)->second;
+		// If new pair, initialize it properly
+		if (pair.m_state == overlap_pair::state::New)
+			pair = { &m_bodies[i],&m_bodies[j],&m_meshes[i],&m_meshes[j] };
+		else
+		{
+			pair.body_A = &m_bodies[i];
+			pair.body_B = &m_bodies[j];
+			pair.mesh_A = &m_meshes[i];
+			pair.mesh_B = &m_meshes[j];
+		}
+		// Pairs without awake bodies keep their last state
+		if (!is_awake(m_bodies[i]) && !is_awake(m_bodies[j]))
+			continue;
+		m_candidates.push_back({ &pair, i, j });
+	}
+}
+/**
+ * Body of the static shape with the id
+**/
+body& c_physics::get_static_body(uint id)
+{
+	const static_shape& shape = m_static_shapes[id];
+	return shape.m_heightfield ? m_heightfield_bodies[shape.m_index] : m_static_bodies[shape.m_index];
+}
+/**
+ * Check if the body is simulated this step
+**/
+bool c_physics::is_awake(const body & b) const
+{
+	return !b.m_is_static && !b.m_is_sleeping;
+}
+/**
+ * Group the dynamic bodies touching each other, waking
+ * every sleeping island that an awake body is touching
+**/
+void c_physics::build_islands()
+{
+	// Join bodies through their contacts, static bodies do not join islands
+	m_islands.reset(static_cast<uint>(m_bodies.size()));
+	for (auto& it : m_overlaps)
+	{
+		const overlap_pair& pair = it.second;
+		if (pair.m_state == overlap_pair::state::Collision
+		 && !pair.body_A->m_is_static && !pair.body_B->m_is_static)
+			m_islands.merge(static_cast<uint>(pair.body_A - m_bodies.data()), static_cast<uint>(pair.body_B - m_bodies.data()));
+	}
+	m_islands.wake_islands(m_bodies);
+}
+/**
+ * Prepares the constraints of the contacts on the pool. Substeps after
+ * the first only move the points along with the bodies.
+**/
+void c_physics::prestep_contacts(const std::vector<overlap_pair*>& contacts, bool full, float dt)
+{
+	prestep_pairs(contacts, full, dt, &m_pool);
+}
+/**
+ * Solver with the settings of the editor. Substeps run a single iteration and
+ * share the Baumgarte correction, so the whole step corrects the same amount.
+**/
+constraint_contact_solver c_physics::make_solver(thread_pool* pool, bool relax, float dt) const
+{
+	const int substeps = glm::max(editor.m_substeps, 1);
+	return constraint_contact_solver{
+		substeps > 1 ? 1 : editor.m_solver_iterations,
+		editor.m_baumgarte / static_cast<float>(substeps),
+		editor.m_do_warm_start,
+		pool,
+		editor.m_wide_solver,
+		editor.m_block_solver,
+		editor.m_split_impulse && !relax ? editor.m_position_iterations : 0,
+		relax,
+		editor.m_solver_tolerance,
+		editor.m_shock_propagation && !relax ? -glm::normalize(m_gravity) : glm::vec3{ 0.0f },
+		editor.m_mass_splitting,
+		dt };
+}
+/**
+ * Solve the contacts, independent islands run in parallel. Each task gathers
+ * the bodies of its island into the contiguous array of its own solver, the
+ * manifolds stay in the overlap map and are reached through the pairs.
+**/
+void c_physics::solve_contacts(std::vector<overlap_pair*>& contacts, bool relax, float dt)
+{
+	// Serial path
+	if (!editor.m_parallel_solver || m_pool.get_thread_count() == 1u)
+	{
+		constraint_contact_solver solver = make_solver(nullptr, relax, dt);
+		solver.evaluate(contacts);
+		add_residuals(solver.m_residuals, m_convergence);
+		return;
+	}
+	// Pack the contacts of each island together, keeping their order
+	std::vector<uint> island_slot(m_bodies.size(), UINT_MAX);
+	uint island_count{ 0u };
+	for (auto& c : m_island_contacts)
+		c.clear();
+	for (overlap_pair* pair : contacts)
+	{
+		// Static bodies do not belong to islands, use the dynamic one
+		const body* b = pair->body_A->m_is_static ? pair->body_B : pair->body_A;
+		const uint root = m_islands.find(static_cast<uint>(b - m_bodies.data()));
+		if (island_slot[root] == UINT_MAX)
+			island_slot[root] = island_count++;
+		if (m_island_contacts.size() < island_count)
+			m_island_contacts.resize(island_count);
+		m_island_contacts[island_slot[root]].push_back(pair);
+	}
+	// Big islands are colored and solved in parallel one after another
+	std::vector<uint> small_islands;
+	for (uint i = 0; i < island_count; ++i)
+	{
+		if (m_island_contacts[i].size() >= c_colored_island_size)
+		{
+			constraint_contact_solver solver = make_solver(&m_pool, relax, dt);
+			solver.evaluate(m_island_contacts[i]);
+			add_residuals(solver.m_residuals, m_convergence);
+		}
+		else
+			small_islands.push_back(i);
+	}
+	// The rest are independent tasks, they share no body so no synchronization is needed
+	m_thread_convergence.resize(m_pool.get_thread_count());
+	m_pool.parallel_for(static_cast<uint>(small_islands.size()), 1u, [&](uint begin, uint end, uint thread)
+	{
+		for (uint i = begin; i < end; ++i)
+		{
+			constraint_contact_solver solver = make_solver(nullptr, relax, dt);
+			solver.evaluate(m_island_contacts[small_islands[i]]);
+			add_residuals(solver.m_residuals, m_thread_convergence[thread]);
+		}
+	});
+	// Merge the curves of the threads
+	for (auto& curve : m_thread_convergence)
+	{
+		add_residuals(curve, m_convergence);
+		curve.clear();
+	}
+}
+/**
+ * Keeps the biggest residual of each iteration
+**/
+void c_physics::add_residuals(const std::vector<float>& residuals, std::vector<float>& curve)
+{
+	if (curve.size() < residuals.size())
+		curve.resize(residuals.size(), 0.0f);
+	for (uint i = 0; i < residuals.size(); ++i)
+		curve[i] = glm::max(curve[i], residuals[i]);
+}
+/**
+ * Islands sleep once all their bodies have been still for long enough
+**/
+void c_physics::update_sleeping(float dt)
+{
+	// Find the shortest still time of each island
+	std::vector<float> island_time(m_bodies.size(), FLT_MAX);
+	for (uint i = 0; i < m_bodies.size(); ++i)
 	{
-		const glm::vec3 pA = tr_point(o->body_A->get_model(), p.local_A);
-		const glm::vec3 pB = tr_point(o->body_B->get_model(), p.local_B);
-		drawer.add_debugline(pA, pB, red);
-		drawer.add_debugline_cube(pA, 0.1f, red);
-		drawer.add_debugline_cube(pB, 0.1f, blue);
-		drawer.add_debugline(pA, pA + o->manifold.normal * p.depth, green);
+		body& b = m_bodies[i];
+		if (!is_awake(b))
+			continue;
+		b.update_sleep_time(dt);
+		const uint root = m_islands.find(i);
+		island_time[root] = glm::min(island_time[root], b.m_sleep_time);
 	}
-	// Integrate positions
-	for (auto& b : m_bodies)
-		b.integrate_positions(physics_dt);
+	// Put to sleep the bodies of still islands
+	for (uint i = 0; i < m_bodies.size(); ++i)
+		if (is_awake(m_bodies[i]) && island_time[m_islands.find(i)] >= c_time_to_sleep)
+			m_bodies[i].put_to_sleep();
 }
 
 /**
@@ -126,7 +796,22 @@ void c_physics::clean()
 {
 	m_bodies.clear();
 	m_meshes.clear();
+	m_body_slots.clear();
+	m_broadphase.clear();
+	m_proxies.clear();
 	m_overlaps.clear();
+	m_hull_caches.clear();
+	m_static_meshes.clear();
+	m_static_bodies.clear();
+	m_heightfields.clear();
+	m_heightfield_bodies.clear();
+	m_static_shapes.clear();
+	m_static_mesh_ids.clear();
+	m_heightfield_ids.clear();
+	m_debug_shapes.clear();
+	m_static_debug_shapes.clear();
+	m_static_overlaps.clear();
+	m_contacts.clear();
 }
 
 /**
@@ -166,12 +851,99 @@ body& c_physics::add_body(std::string file)
 	m_meshes.emplace_back(std::move(m));
 	// Create new body
 	m_bodies.push_back({});
+	m_body_slots.insert();
+	// The broadphase adds its proxy on the next step
+	m_proxies.push_back(broadphase::c_null);
+	// The last contacts may point to the old array
+	m_contacts.clear();
 	// Initialize with mesh properties
 	m_bodies.back().set_mass(raw.m_mass).set_inertia(raw.m_inertia);
 	// Return newly created body
 	return m_bodies.back();
 }
 
+/**
+ *  Remove a body from the system, moving the last body into its place.
+ *  Returns false if the handle was stale.
+**/
+bool c_physics::remove_body(body_handle h)
+{
+	const uint idx = m_body_slots.erase(h);
+	if (idx == UINT_MAX)
+		return false;
+	// Pairs against static geometry are found by slot, a new body may take it
+	m_static_overlaps.erase(m_static_overlaps.lower_bound({ h.m_slot, 0u, 0u }), m_static_overlaps.lower_bound({ h.m_slot + 1u, 0u, 0u }));
+	// Bodies added since the last publish have no drawing geometry yet
+	m_debug_shapes.resize(m_bodies.size());
+	std::swap(m_debug_shapes[idx], m_debug_shapes.back());
+	m_debug_shapes.pop_back();
+	// Wake the bodies touching it and move the last body into the hole. Pairs against
+	// other bodies go stale with the handle, the broadphase drops them.
+	swap_remove_body(idx, m_bodies, m_meshes, m_proxies, m_broadphase);
+	// The last contacts may point to the removed body
+	m_contacts.clear();
+	return true;
+}
+
+/**
+ *  Body of the handle, null if it was removed
+**/
+body* c_physics::get_body(body_handle h)
+{
+	const uint idx = m_body_slots.find(h);
+	return idx == UINT_MAX ? nullptr : &m_bodies[idx];
+}
+
+/**
+ *  Handle of a body of the system
+**/
+body_handle c_physics::get_handle(const body& b) const
+{
+	return m_body_slots.get_handle(static_cast<uint>(&b - m_bodies.data()));
+}
+
+/**
+ *  Add static triangle geometry to the system
+**/
+body& c_physics::add_static_mesh(const std::vector<glm::vec3>& vertices, const std::vector<uint>& indices)
+{
+	assert(indices.size() % 3 == 0);
+	// Create triangle mesh
+	triangle_mesh m;
+	m.m_vertices = vertices;
+	m.m_triangles.reserve(indices.size() / 3);
+	for (uint i = 0; i + 2 < indices.size(); i += 3)
+		m.m_triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+	// Build the hierarchy
+	m.build();
+	// Move mesh into the final array
+	m_static_meshes.emplace_back(std::move(m));
+	// Next static shape id
+	m_static_mesh_ids.push_back(static_cast<uint>(m_static_shapes.size()));
+	m_static_shapes.push_back({ false, static_cast<uint>(m_static_meshes.size()) - 1u });
+	// Create new static body
+	m_static_bodies.push_back({});
+	// Return newly created body
+	return m_static_bodies.back().set_static(true);
+}
+
+/**
+ *  Add a static heightfield to the system
+**/
+body& c_physics::add_heightfield(uint size_x, uint size_z, float cell_size, const std::vector<float>& heights)
+{
+	// Create heightfield
+	m_heightfields.push_back({});
+	m_heightfields.back().set_heights(size_x, size_z, cell_size, heights);
+	// Next static shape id
+	m_heightfield_ids.push_back(static_cast<uint>(m_static_shapes.size()));
+	m_static_shapes.push_back({ true, static_cast<uint>(m_heightfields.size()) - 1u });
+	// Create new static body
+	m_heightfield_bodies.push_back({});
+	// Return newly created body
+	return m_heightfield_bodies.back().set_static(true);
+}
+
 /**
  *  Singletone instanciation
 **/
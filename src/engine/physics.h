@@ -9,31 +9,173 @@
 #include "raw_mesh.h"
 #include <physics/physical_mesh.h>
 #include <physics/body.h>
+#include <physics/body_soa.h>
+#include <physics/body_removal.h>
+#include <physics/broadphase.h>
+#include <physics/slot_map.h>
 #include <physics/contact_info.h>
+#include <physics/contact_solver.h>
 #include <physics/ray.h>
+#include <physics/hull_cache.h>
+#include <physics/island.h>
+#include <physics/thread_pool.h>
+#include <physics/triangle_mesh.h>
+#include <physics/heightfield.h>
+#include <physics/triple_buffer.h>
 #include <map>
 #include <array>
+#include <tuple>
+#include <chrono>
+#include <memory>
 
 struct ray_info_detailed : public ray_info
 {
 	glm::vec3 m_pi;
 	uint m_body;
+	bool m_static_geometry{ false };
+};
+using body_handle = slot_handle;
+using pair_key = std::pair<body_handle, body_handle>;
+using static_key = std::tuple<uint, uint, uint>;
+// Array and index of a static shape
+struct static_shape
+{
+	bool m_heightfield;
+	uint m_index;
+};
+struct narrow_candidate
+{
+	overlap_pair* m_pair;
+	uint m_body_A;
+	uint m_body_B;
+};
+
+struct debug_contact
+{
+	glm::vec3 m_point_A;
+	glm::vec3 m_point_B;
+	glm::vec3 m_penetration;
+};
+/**
+ * Local space geometry of a shape for drawing, built once and shared by the snapshots
+**/
+struct debug_shape
+{
+	std::vector<glm::vec3> m_lines;
+	std::vector<glm::vec3> m_points;
+	std::vector<glm::vec3> m_normals;
+};
+/**
+ * State published after each step, read by the editor and the drawer
+ * while the next step runs
+**/
+struct physics_snapshot
+{
+	std::vector<body> m_bodies;
+	std::vector<std::shared_ptr<const debug_shape>> m_shapes;
+	// Triangle meshes and heightfields with their model matrices
+	std::vector<std::shared_ptr<const debug_shape>> m_static_shapes;
+	std::vector<glm::mat4> m_static_models;
+	std::vector<debug_contact> m_contacts;
+	// Biggest lambda change of each solver iteration of the last step
+	std::vector<float> m_convergence;
+	// Position between the last two steps when it was published
+	float m_interpolation{ 1.0f };
+	double m_step_time{ 1.0 / 60.0 };
+	std::chrono::steady_clock::time_point m_time{ std::chrono::steady_clock::now() };
+
+	float get_interpolation()const;
 };
 
 class c_physics
 {
+	// Islands with this many contacts are colored instead of solved as a single task
+	static const uint c_colored_island_size{ 256u };
+
+	void simulate(double frame_time);
+	void step(float dt);
+	void publish();
+	void run();
 	ray_info_detailed ray_cast(const ray&)const;
-	bool collision_narrow(overlap_pair * pair)const;
+	bool collision_narrow(overlap_pair * pair, const hull_cache& cache_A, const hull_cache& cache_B, float dt)const;
+	float contact_margin(const body& a, const body& b, float dt)const;
+	template<typename T>
+	void collision_static(uint body_idx, uint shape_id, const T& shape, body* shape_body, float dt, std::map<static_key, overlap_pair>& next_overlaps);
+	body& get_static_body(uint id);
+	bool is_awake(const body& b)const;
+	void build_islands();
+	void prestep_contacts(const std::vector<overlap_pair*>& contacts, bool full, float dt);
+	constraint_contact_solver make_solver(thread_pool* pool, bool relax, float dt)const;
+	void solve_contacts(std::vector<overlap_pair*>& contacts, bool relax, float dt);
+	static void add_residuals(const std::vector<float>& residuals, std::vector<float>& curve);
+	void update_sleeping(float dt);
+	void update_broadphase(float dt);
+	float time_of_impact(uint body_idx, float dt)const;
+	void resolve_impact(uint body_idx, float dt);
+	template<typename T>
+	float time_of_impact_static(uint body_idx, const T& shape, const body& shape_body, const aabb& swept, float toi)const;
 	std::vector<physical_mesh> m_meshes;
 	std::vector<body> m_bodies;
+	// Handles of the bodies, removing one moves the last body into its place
+	slot_map m_body_slots;
+	// Proxy of each body in the broadphase, and their boxes this step
+	broadphase m_broadphase;
+	std::vector<uint> m_proxies;
+	std::vector<aabb> m_boxes;
+	std::vector<std::pair<uint, uint>> m_new_pairs;
+	// Integration state of the bodies by component
+	body_soa m_body_soa;
+	// Time each body moves during a substep
+	std::vector<float> m_steps;
+	std::vector<hull_cache> m_hull_caches;
+	std::vector<triangle_mesh> m_static_meshes;
+	std::vector<body> m_static_bodies;
+	std::vector<heightfield> m_heightfields;
+	std::vector<body> m_heightfield_bodies;
+	// Static shapes by id, in the order they were added. The ids key their pairs
+	// and their drawing geometry, so they do not change with later shapes.
+	std::vector<static_shape> m_static_shapes;
+	std::vector<uint> m_static_mesh_ids;
+	std::vector<uint> m_heightfield_ids;
+	// Drawing geometry of the bodies and the static shapes, built when first published
+	std::vector<std::shared_ptr<const debug_shape>> m_debug_shapes;
+	std::vector<std::shared_ptr<const debug_shape>> m_static_debug_shapes;
 	std::map<std::string, raw_mesh> m_loaded_meshes;
-	std::map<std::pair<uint,uint>, overlap_pair> m_overlaps;
+	// Pairs are dropped once their proxies stop overlapping or a body is removed
+	std::map<pair_key, overlap_pair> m_overlaps;
+	// Keyed by the slot of the body, the shape and the triangle
+	std::map<static_key, overlap_pair> m_static_overlaps;
+	island_graph m_islands;
+	std::vector<narrow_candidate> m_candidates;
+	std::vector<overlap_pair*> m_contacts;
+	std::vector<std::vector<overlap_pair*>> m_island_contacts;
+	// Biggest lambda change of each solver iteration this frame, over all the solves
+	std::vector<float> m_convergence;
+	std::vector<std::vector<float>> m_thread_convergence;
+	thread_pool m_pool;
+	task_graph m_step_graph;
 	glm::vec3 m_gravity{ 0.f, -10.f, 0.f };
+	// Frame time not simulated yet
+	double m_accumulator{ 0.0 };
+	double m_step_time{ 1.0 / 60.0 };
+	// Latest state for rendering, written only while the world is locked
+	triple_buffer<physics_snapshot> m_snapshots;
+	// Held by the physics thread during a step and by the editor while it edits the world
+	std::mutex m_world_mutex;
+	std::thread m_thread;
+	std::atomic<bool> m_running{ false };
 
 public:
+	void start();
+	void stop();
 	void update();
 	void clean();
 	body& add_body(std::string file);
+	bool remove_body(body_handle h);
+	body* get_body(body_handle h);
+	body_handle get_handle(const body& b)const;
+	body& add_static_mesh(const std::vector<glm::vec3>& vertices, const std::vector<uint>& indices);
+	body& add_heightfield(uint size_x, uint size_z, float cell_size, const std::vector<float>& heights);
 
 	bool m_draw_minkowski{false};
 	bool m_draw_gjk_simplex{ false };
@@ -0,0 +1,99 @@
+/**
+ * @file aabb.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Axis aligned bounding box
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "aabb.h"
+#include "math_utils.h"
+
+/**
+ * Grow the box to contain the point
+**/
+void aabb::add_point(const glm::vec3 & p)
+{
+	m_min = glm::min(m_min, p);
+	m_max = glm::max(m_max, p);
+}
+/**
+ * Grow the box to contain other box
+**/
+void aabb::add_box(const aabb & other)
+{
+	m_min = glm::min(m_min, other.m_min);
+	m_max = glm::max(m_max, other.m_max);
+}
+/**
+ * Grow the box on every direction
+**/
+void aabb::inflate(float margin)
+{
+	m_min -= glm::vec3{ margin };
+	m_max += glm::vec3{ margin };
+}
+/**
+ * Check if two boxes are overlapping
+**/
+bool aabb::overlaps(const aabb & other) const
+{
+	return m_min.x <= other.m_max.x && other.m_min.x <= m_max.x
+		&& m_min.y <= other.m_max.y && other.m_min.y <= m_max.y
+		&& m_min.z <= other.m_max.z && other.m_min.z <= m_max.z;
+}
+/**
+ * Check if the other box is completely inside this one
+**/
+bool aabb::contains(const aabb & other) const
+{
+	return m_min.x <= other.m_min.x && other.m_max.x <= m_max.x
+		&& m_min.y <= other.m_min.y && other.m_max.y <= m_max.y
+		&& m_min.z <= other.m_min.z && other.m_max.z <= m_max.z;
+}
+/**
+ * Perform the slab test of the ray against the box
+**/
+bool aabb::ray_cast(const ray & r, float max_time) const
+{
+	float t_min{ 0.0f };
+	float t_max{ max_time };
+	for (int i = 0; i < 3; ++i)
+	{
+		// Parallel ray -> must start between the slabs
+		if (std::abs(r.m_direction[i]) < c_epsilon)
+		{
+			if (r.m_start[i] < m_min[i] || r.m_start[i] > m_max[i])
+				return false;
+			continue;
+		}
+		// Intersect both slabs
+		const float inv_d = 1.0f / r.m_direction[i];
+		float t0 = (m_min[i] - r.m_start[i]) * inv_d;
+		float t1 = (m_max[i] - r.m_start[i]) * inv_d;
+		if (t0 > t1)
+			std::swap(t0, t1);
+		t_min = glm::max(t_min, t0);
+		t_max = glm::min(t_max, t1);
+		if (t_min > t_max)
+			return false;
+	}
+	return true;
+}
+glm::vec3 aabb::get_center() const
+{
+	return (m_min + m_max) * 0.5f;
+}
+glm::vec3 aabb::get_extent() const
+{
+	return (m_max - m_min) * 0.5f;
+}
+/**
+ * Compute the box enclosing the transformed box
+**/
+aabb aabb::transform(const glm::mat4 & tr) const
+{
+	const glm::vec3 c = tr_point(tr, get_center());
+	const glm::mat3 abs_basis{ glm::abs(glm::vec3(tr[0])), glm::abs(glm::vec3(tr[1])), glm::abs(glm::vec3(tr[2])) };
+	const glm::vec3 e = abs_basis * get_extent();
+	return { c - e, c + e };
+}
@@ -0,0 +1,27 @@
+/**
+ * @file aabb.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Axis aligned bounding box
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include "ray.h"
+#include <glm/glm.hpp>
+#include <cfloat>
+
+struct aabb
+{
+	glm::vec3 m_min{ FLT_MAX };
+	glm::vec3 m_max{ -FLT_MAX };
+
+	void add_point(const glm::vec3& p);
+	void add_box(const aabb& other);
+	void inflate(float margin);
+	bool overlaps(const aabb& other)const;
+	bool contains(const aabb& other)const;
+	bool ray_cast(const ray& r, float max_time)const;
+	glm::vec3 get_center()const;
+	glm::vec3 get_extent()const;
+	aabb transform(const glm::mat4& tr)const;
+};
@@ -7,7 +7,6 @@
 **/
 #include "body.h"
 #include "math_utils.h"
-float physics_dt = 1.f/60.f;
 
 glm::vec3 check_zero(glm::vec3 v)
 {
@@ -31,7 +30,10 @@ void body::add_impulse_angular(glm::vec3 impulse)
 	//	m_angular_momentum = check_zero(m_angular_momentum + impulse);
 
 	if (!m_is_static)
+	{
 		m_angular_momentum = check_zero(m_angular_momentum + impulse);
+		m_is_sleeping = false;
+	}
 }
 
 void body::add_impulse_linear(glm::vec3 impulse)
@@ -39,12 +41,15 @@ void body::add_impulse_linear(glm::vec3 impulse)
 	//if (isnan(impulse.x) || isnan(impulse.y) || isnan(impulse.z))
 	//	m_angular_momentum = check_zero(m_angular_momentum + impulse);
 	if (!m_is_static)
+	{
 		m_linear_momentum = check_zero(m_linear_momentum + impulse);
+		m_is_sleeping = false;
+	}
 }
 
 void body::integrate_velocities(const float dt, const glm::vec3& gravity)
 {
-	if (!m_is_static)
+	if (!m_is_static && !m_is_sleeping)
 	{
 		// Apply gravity
 		m_linear_momentum += dt * gravity*get_mass();
@@ -58,7 +63,7 @@ void body::integrate_velocities(const float dt, const glm::vec3& gravity)
 }
 void body::integrate_positions(const float dt)
 {
-	if (!m_is_static)
+	if (!m_is_static && !m_is_sleeping)
 	{
 		// Apply velocity
 		m_position += get_linear_velocity() * dt;
@@ -71,12 +76,17 @@ void body::integrate_positions(const float dt)
 }
 body & body::set_position(glm::vec3 pos)
 {
+	// Teleports are not interpolated
 	m_position = pos;
+	m_prev_position = pos;
+	wake_up();
 	return *this;
 }
 body & body::set_rotation(glm::quat rot)
 {
 	m_rotation = rot;
+	m_prev_rotation = rot;
+	wake_up();
 	return *this;
 }
 body & body::set_mass(float mass)
@@ -116,6 +126,7 @@ body & body::set_static(bool is_static)
 {
 	m_is_static = is_static;
 	clear_momentum();
+	wake_up();
 	return *this;
 }
 body & body::set_friction(float f)
@@ -133,6 +144,37 @@ body & body::set_restitution(float r)
 	m_restitution_coef = r;
 	return *this;
 }
+body & body::set_ccd(bool ccd)
+{
+	m_ccd = ccd;
+	return *this;
+}
+void body::wake_up()
+{
+	m_is_sleeping = false;
+	m_sleep_time = 0.0f;
+}
+void body::put_to_sleep()
+{
+	m_is_sleeping = true;
+	clear_momentum();
+}
+/**
+ * Accumulates the time the body has been almost still
+**/
+void body::update_sleep_time(float dt)
+{
+	if (glm::length2(get_linear_velocity()) < c_sleep_linear_velocity * c_sleep_linear_velocity
+	 && glm::length2(get_angular_velocity()) < c_sleep_angular_velocity * c_sleep_angular_velocity)
+		m_sleep_time += dt;
+	else
+		m_sleep_time = 0.0f;
+}
+void body::store_pose()
+{
+	m_prev_position = m_position;
+	m_prev_rotation = m_rotation;
+}
 void body::clear_momentum()
 {
 	m_linear_momentum = glm::vec3{};
@@ -148,6 +190,26 @@ glm::mat4 body::get_invmodel() const
 	return glm::inverse(get_model());
 }
 
+glm::mat4 body::get_interpolated_model(float t) const
+{
+	// Blend from the pose before the last step to the current one
+	const glm::vec3 pos = glm::mix(m_prev_position, m_position, t);
+	const glm::quat rot = glm::slerp(m_prev_rotation, m_rotation, t);
+	return glm::translate(glm::mat4(1.0f), pos) * glm::mat4_cast(rot);
+}
+
+glm::mat4 body::get_predicted_model(float dt) const
+{
+	if (m_is_static)
+		return get_model();
+	// Same integration as integrate_positions
+	const glm::vec3 pos = m_position + get_linear_velocity() * dt;
+	const glm::vec3 w = get_angular_velocity();
+	const glm::quat w_quat{ 0.0f, w.x, w.y, w.z };
+	const glm::quat rot = glm::normalize(m_rotation + .5f * w_quat * m_rotation * dt);
+	return glm::translate(glm::mat4(1.0f), pos) * glm::mat4_cast(rot);
+}
+
 glm::mat3 body::get_basis() const
 {
 	return glm::mat3_cast(m_rotation);
@@ -27,10 +27,17 @@ struct body
 	body& set_friction(float f);
 	body& set_roll(float r);
 	body& set_restitution(float r);
+	body& set_ccd(bool ccd);
 	void clear_momentum();
+	void wake_up();
+	void put_to_sleep();
+	void update_sleep_time(float dt);
+	void store_pose();
 
 	glm::mat4 get_model()const;
 	glm::mat4 get_invmodel()const;
+	glm::mat4 get_predicted_model(float dt)const;
+	glm::mat4 get_interpolated_model(float t)const;
 	glm::mat3 get_basis()const;
 	glm::vec3 get_linear_velocity()const;
 	glm::vec3 get_angular_velocity()const;
@@ -48,6 +55,12 @@ struct body
 	float m_friction_coef{ 0.00f };
 	float m_roll_coef{ 0.00f };
 	float m_restitution_coef{ 0.2f };
+	bool m_ccd{ false };
+	bool m_is_sleeping{ false };
+	float m_sleep_time{ 0.0f };
+	glm::vec3 m_prev_position{ 0.0f, 0.0f, 0.0f };
+	glm::quat m_prev_rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
 };
 
-extern float physics_dt;
\ No newline at end of file
+// Default duration of a step, the engine passes the duration of its own steps
+const float physics_dt{ 1.0f / 60.0f };
\ No newline at end of file
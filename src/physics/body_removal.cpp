@@ -0,0 +1,40 @@
+/**
+ * @file body_removal.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Removing bodies from the packed arrays of the world
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "body_removal.h"
+
+/**
+ * Removes the body at the index, moving the last body into its place as slot_map::erase
+ * expects. The bodies whose proxies overlap its proxy are woken, so nothing sleeps
+ * resting on it. Their islands wake with them.
+**/
+void swap_remove_body(uint idx, std::vector<body>& bodies, std::vector<physical_mesh>& meshes, std::vector<uint>& proxies, broadphase& tree)
+{
+	// Bodies added since the last step have no proxy and touch nothing yet
+	const uint proxy = proxies[idx];
+	if (proxy != broadphase::c_null)
+	{
+		std::vector<uint> touching;
+		tree.query(tree.get_box(proxy), touching);
+		for (uint p : touching)
+			bodies[tree.get_user(p)].wake_up();
+		tree.remove_proxy(proxy);
+	}
+	// Move the last body into the hole
+	const uint last = static_cast<uint>(bodies.size()) - 1u;
+	if (idx != last)
+	{
+		bodies[idx] = std::move(bodies[last]);
+		meshes[idx] = std::move(meshes[last]);
+		proxies[idx] = proxies[last];
+		if (proxies[idx] != broadphase::c_null)
+			tree.set_user(proxies[idx], idx);
+	}
+	bodies.pop_back();
+	meshes.pop_back();
+	proxies.pop_back();
+}
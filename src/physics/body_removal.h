@@ -0,0 +1,16 @@
+/**
+ * @file body_removal.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Removing bodies from the packed arrays of the world
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include "body.h"
+#include "physical_mesh.h"
+#include "broadphase.h"
+#include <vector>
+
+using uint = unsigned int;
+
+void swap_remove_body(uint idx, std::vector<body>& bodies, std::vector<physical_mesh>& meshes, std::vector<uint>& proxies, broadphase& tree);
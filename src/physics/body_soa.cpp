@@ -0,0 +1,249 @@
+/**
+ * @file body_soa.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Bodies integrated by component, a register of bodies at a time
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "body_soa.h"
+#include "thread_pool.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * Apply gravity and damping to the awake bodies, as body::integrate_velocities
+**/
+void body_soa::integrate_velocities(std::vector<body>& bodies, float dt, const glm::vec3 & gravity, thread_pool * pool)
+{
+	const uint count = static_cast<uint>(bodies.size());
+	resize(count);
+	// A new time step invalidates every damping factor
+	if (dt != m_damping_dt)
+	{
+		m_damping_dt = dt;
+		m_linear_damping.assign(m_linear_damping.size(), std::numeric_limits<float>::quiet_NaN());
+		m_angular_damping.assign(m_angular_damping.size(), std::numeric_limits<float>::quiet_NaN());
+	}
+	const glm::vec3 gravity_dt = dt * gravity;
+	// The ranges may hold several blocks when the pool runs them inline
+	auto blocks = [&](uint begin, uint end, uint)
+	{
+		for (uint i = begin; i < end; i += c_block_size)
+			integrate_velocities(bodies, i, std::min(end, i + c_block_size), gravity_dt);
+	};
+	if (pool)
+		pool->parallel_for(count, c_block_size, blocks);
+	else
+		blocks(0u, count, 0u);
+}
+
+/**
+ * Move the awake bodies by their velocities during their own step, as body::integrate_positions
+**/
+void body_soa::integrate_positions(std::vector<body>& bodies, const std::vector<float>& steps, thread_pool * pool)
+{
+	const uint count = static_cast<uint>(bodies.size());
+	resize(count);
+	auto blocks = [&](uint begin, uint end, uint)
+	{
+		for (uint i = begin; i < end; i += c_block_size)
+			integrate_positions(bodies, steps, i, std::min(end, i + c_block_size));
+	};
+	if (pool)
+		pool->parallel_for(count, c_block_size, blocks);
+	else
+		blocks(0u, count, 0u);
+}
+
+void body_soa::resize(uint count)
+{
+	if (count == m_linear_factor.size())
+		return;
+	m_linear_damping.assign(count, std::numeric_limits<float>::quiet_NaN());
+	m_angular_damping.assign(count, std::numeric_limits<float>::quiet_NaN());
+	m_linear_factor.assign(count, 1.0f);
+	m_angular_factor.assign(count, 1.0f);
+}
+
+void body_soa::integrate_velocities(std::vector<body>& bodies, uint begin, uint end, const glm::vec3 & gravity_dt)
+{
+	// Block by component, padded to whole registers with bodies that do not move
+	const uint count = end - begin;
+	const uint size = (count + c_simd_lanes - 1u) / c_simd_lanes * c_simd_lanes;
+	alignas(32) float linear_momentum[3][c_block_size];
+	alignas(32) float angular_momentum[3][c_block_size];
+	alignas(32) float gravity_scale[c_block_size];
+	alignas(32) float linear_factor[c_block_size];
+	alignas(32) float angular_factor[c_block_size];
+	// Gather
+	for (uint j = 0; j < size; ++j)
+	{
+		if (j >= count)
+		{
+			for (uint c = 0; c < 3u; ++c)
+				linear_momentum[c][j] = angular_momentum[c][j] = 0.0f;
+			gravity_scale[j] = linear_factor[j] = angular_factor[j] = 0.0f;
+			continue;
+		}
+		const uint i = begin + j;
+		const body& b = bodies[i];
+		for (uint c = 0; c < 3u; ++c)
+		{
+			linear_momentum[c][j] = b.m_linear_momentum[c];
+			angular_momentum[c][j] = b.m_angular_momentum[c];
+		}
+		const bool awake = !b.m_is_static && !b.m_is_sleeping;
+		gravity_scale[j] = awake ? b.get_mass() : 0.0f;
+		// Only recompute the damping factors that changed
+		if (b.m_linear_damping != m_linear_damping[i])
+		{
+			m_linear_damping[i] = b.m_linear_damping;
+			m_linear_factor[i] = std::pow(1.0f - b.m_linear_damping, m_damping_dt);
+		}
+		if (b.m_angular_damping != m_angular_damping[i])
+		{
+			m_angular_damping[i] = b.m_angular_damping;
+			m_angular_factor[i] = std::pow(1.0f - b.m_angular_damping, m_damping_dt);
+		}
+		linear_factor[j] = m_linear_factor[i];
+		angular_factor[j] = m_angular_factor[i];
+	}
+	// Integrate
+	const wide_float g[3]{ wide_float{ gravity_dt.x }, wide_float{ gravity_dt.y }, wide_float{ gravity_dt.z } };
+	for (uint j = 0; j < size; j += c_simd_lanes)
+	{
+		const wide_float scale = wide_load(&gravity_scale[j]);
+		const wide_float linear = wide_load(&linear_factor[j]);
+		const wide_float angular = wide_load(&angular_factor[j]);
+		for (uint c = 0; c < 3u; ++c)
+		{
+			const wide_float l = wide_load(&linear_momentum[c][j]) + g[c] * scale;
+			wide_store(&linear_momentum[c][j], l * linear);
+			wide_store(&angular_momentum[c][j], wide_load(&angular_momentum[c][j]) * angular);
+		}
+	}
+	// Scatter, bodies not integrated are left untouched
+	for (uint j = 0; j < count; ++j)
+	{
+		body& b = bodies[begin + j];
+		if (b.m_is_static || b.m_is_sleeping)
+			continue;
+		for (uint c = 0; c < 3u; ++c)
+		{
+			b.m_linear_momentum[c] = linear_momentum[c][j];
+			b.m_angular_momentum[c] = angular_momentum[c][j];
+		}
+	}
+}
+
+void body_soa::integrate_positions(std::vector<body>& bodies, const std::vector<float>& steps, uint begin, uint end)const
+{
+	// Block by component, padded to whole registers with bodies that do not move
+	const uint count = end - begin;
+	const uint size = (count + c_simd_lanes - 1u) / c_simd_lanes * c_simd_lanes;
+	alignas(32) float position[3][c_block_size];
+	alignas(32) float rotation[4][c_block_size];
+	alignas(32) float linear_momentum[3][c_block_size];
+	alignas(32) float angular_momentum[3][c_block_size];
+	alignas(32) float inv_mass[c_block_size];
+	alignas(32) float inv_inertia[9][c_block_size];
+	alignas(32) float step[c_block_size];
+	// Gather
+	for (uint j = 0; j < size; ++j)
+	{
+		if (j >= count)
+		{
+			// A valid rotation so normalizing the padding is harmless
+			for (uint c = 0; c < 3u; ++c)
+				position[c][j] = linear_momentum[c][j] = angular_momentum[c][j] = 0.0f;
+			for (uint c = 0; c < 4u; ++c)
+				rotation[c][j] = c == 0u ? 1.0f : 0.0f;
+			for (uint c = 0; c < 9u; ++c)
+				inv_inertia[c][j] = 0.0f;
+			inv_mass[j] = step[j] = 0.0f;
+			continue;
+		}
+		const body& b = bodies[begin + j];
+		for (uint c = 0; c < 3u; ++c)
+		{
+			position[c][j] = b.m_position[c];
+			linear_momentum[c][j] = b.m_linear_momentum[c];
+			angular_momentum[c][j] = b.m_angular_momentum[c];
+		}
+		rotation[0][j] = b.m_rotation.w;
+		rotation[1][j] = b.m_rotation.x;
+		rotation[2][j] = b.m_rotation.y;
+		rotation[3][j] = b.m_rotation.z;
+		inv_mass[j] = b.get_invmass();
+		const glm::mat3 local_inertia = b.get_local_invinertia();
+		for (uint c = 0; c < 9u; ++c)
+			inv_inertia[c][j] = local_inertia[c / 3u][c % 3u];
+		step[j] = steps[begin + j];
+	}
+	// Same operations in the same order as the glm functions body uses
+	const wide_float one{ 1.0f };
+	const wide_float two{ 2.0f };
+	const wide_float half{ 0.5f };
+	for (uint j = 0; j < size; j += c_simd_lanes)
+	{
+		const wide_float dt = wide_load(&step[j]);
+		const wide_float im = wide_load(&inv_mass[j]);
+		// Apply velocity
+		for (uint c = 0; c < 3u; ++c)
+		{
+			const wide_float v = im * wide_load(&linear_momentum[c][j]);
+			wide_store(&position[c][j], wide_load(&position[c][j]) + v * dt);
+		}
+		// Rotation matrix, as glm::toMat3
+		const wide_float qw = wide_load(&rotation[0][j]);
+		const wide_float qx = wide_load(&rotation[1][j]);
+		const wide_float qy = wide_load(&rotation[2][j]);
+		const wide_float qz = wide_load(&rotation[3][j]);
+		const wide_float qxx = qx * qx, qyy = qy * qy, qzz = qz * qz;
+		const wide_float qxz = qx * qz, qxy = qx * qy, qyz = qy * qz;
+		const wide_float qwx = qw * qx, qwy = qw * qy, qwz = qw * qz;
+		wide_mat3 r;
+		r.col[0] = { one - two * (qyy + qzz), two * (qxy + qwz), two * (qxz - qwy) };
+		r.col[1] = { two * (qxy - qwz), one - two * (qxx + qzz), two * (qyz + qwx) };
+		r.col[2] = { two * (qxz + qwy), two * (qyz - qwx), one - two * (qxx + qyy) };
+		// Oriented inverse inertia, R * I * transpose(R)
+		wide_mat3 inertia;
+		for (uint c = 0; c < 3u; ++c)
+			inertia.col[c] = { wide_load(&inv_inertia[3u * c][j]), wide_load(&inv_inertia[3u * c + 1u][j]), wide_load(&inv_inertia[3u * c + 2u][j]) };
+		wide_mat3 ri;
+		for (uint c = 0; c < 3u; ++c)
+			ri.col[c] = r * inertia.col[c];
+		const wide_vec3 rt[3]{ { r.col[0].x, r.col[1].x, r.col[2].x }, { r.col[0].y, r.col[1].y, r.col[2].y }, { r.col[0].z, r.col[1].z, r.col[2].z } };
+		wide_mat3 world_inertia;
+		for (uint c = 0; c < 3u; ++c)
+			world_inertia.col[c] = ri * rt[c];
+		const wide_vec3 a{ wide_load(&angular_momentum[0][j]), wide_load(&angular_momentum[1][j]), wide_load(&angular_momentum[2][j]) };
+		const wide_vec3 w = world_inertia * a;
+		// Apply rotation, q + 0.5 * (0, w) * q * dt
+		const wide_float pw = wide_float{} * half;
+		const wide_float px = w.x * half, py = w.y * half, pz = w.z * half;
+		const wide_float dw = pw * qw - px * qx - py * qy - pz * qz;
+		const wide_float dx = pw * qx + px * qw + py * qz - pz * qy;
+		const wide_float dy = pw * qy + py * qw + pz * qx - px * qz;
+		const wide_float dz = pw * qz + pz * qw + px * qy - py * qx;
+		const wide_float nw = qw + dw * dt, nx = qx + dx * dt, ny = qy + dy * dt, nz = qz + dz * dt;
+		// Batched normalization
+		const wide_float inv_length = one / wide_sqrt((nw * nw + nx * nx) + (ny * ny + nz * nz));
+		wide_store(&rotation[0][j], nw * inv_length);
+		wide_store(&rotation[1][j], nx * inv_length);
+		wide_store(&rotation[2][j], ny * inv_length);
+		wide_store(&rotation[3][j], nz * inv_length);
+	}
+	// Scatter, bodies not integrated are left untouched
+	for (uint j = 0; j < count; ++j)
+	{
+		body& b = bodies[begin + j];
+		if (b.m_is_static || b.m_is_sleeping)
+			continue;
+		for (uint c = 0; c < 3u; ++c)
+			b.m_position[c] = position[c][j];
+		b.m_rotation = glm::quat{ rotation[0][j], rotation[1][j], rotation[2][j], rotation[3][j] };
+	}
+}
@@ -0,0 +1,301 @@
+/**
+ * @file broadphase.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Dynamic bounding volume tree finding the pairs of bodies that may touch
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "broadphase.h"
+#include <algorithm>
+
+/**
+ * Surface area of the box, the cost of visiting it in a query
+**/
+static float area(const aabb& box)
+{
+	const glm::vec3 d = box.m_max - box.m_min;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+static aabb merge(const aabb& a, const aabb& b)
+{
+	aabb box = a;
+	box.add_box(b);
+	return box;
+}
+
+/**
+ * Add a proxy for the box, returns its index
+**/
+uint broadphase::add_proxy(const aabb & box, uint user)
+{
+	const uint proxy = allocate();
+	m_nodes[proxy].m_box = box;
+	m_nodes[proxy].m_box.inflate(c_fat_margin);
+	m_nodes[proxy].m_user = user;
+	insert_leaf(proxy);
+	// New proxies look for their pairs
+	m_nodes[proxy].m_moved = true;
+	m_moved.push_back(proxy);
+	return proxy;
+}
+void broadphase::remove_proxy(uint proxy)
+{
+	remove_leaf(proxy);
+	release(proxy);
+}
+/**
+ * Reinserts the proxy if the box left its fat box or the fat box became too
+ * big for it, returns true if it did
+**/
+bool broadphase::move_proxy(uint proxy, const aabb & box)
+{
+	node& n = m_nodes[proxy];
+	aabb huge = box;
+	huge.inflate(4.0f * c_fat_margin);
+	if (n.m_box.contains(box) && huge.contains(n.m_box))
+		return false;
+	remove_leaf(proxy);
+	m_nodes[proxy].m_box = box;
+	m_nodes[proxy].m_box.inflate(c_fat_margin);
+	insert_leaf(proxy);
+	if (!m_nodes[proxy].m_moved)
+	{
+		m_nodes[proxy].m_moved = true;
+		m_moved.push_back(proxy);
+	}
+	return true;
+}
+void broadphase::set_user(uint proxy, uint user)
+{
+	m_nodes[proxy].m_user = user;
+}
+uint broadphase::get_user(uint proxy) const
+{
+	return m_nodes[proxy].m_user;
+}
+/**
+ * Fat box of the proxy
+**/
+const aabb & broadphase::get_box(uint proxy) const
+{
+	return m_nodes[proxy].m_box;
+}
+/**
+ * Proxies whose fat box overlaps the box
+**/
+void broadphase::query(const aabb & box, std::vector<uint>& out) const
+{
+	if (m_root == c_null)
+		return;
+	std::vector<uint> stack{ m_root };
+	while (!stack.empty())
+	{
+		const uint idx = stack.back();
+		stack.pop_back();
+		const node& n = m_nodes[idx];
+		if (!n.m_box.overlaps(box))
+			continue;
+		if (n.is_leaf())
+			out.push_back(idx);
+		else
+		{
+			stack.push_back(n.m_children[1]);
+			stack.push_back(n.m_children[0]);
+		}
+	}
+}
+/**
+ * Adds the users of every new overlap of a moved proxy, the pairs that kept
+ * overlapping may be reported again. The moved proxies are reset.
+**/
+void broadphase::update_pairs(std::vector<std::pair<uint, uint>>& pairs)
+{
+	// A proxy freed and allocated again may be listed twice
+	std::sort(m_moved.begin(), m_moved.end());
+	m_moved.erase(std::unique(m_moved.begin(), m_moved.end()), m_moved.end());
+	std::vector<uint> overlaps;
+	for (uint p : m_moved)
+	{
+		if (!m_nodes[p].m_moved)
+			continue;
+		overlaps.clear();
+		query(m_nodes[p].m_box, overlaps);
+		for (uint q : overlaps)
+		{
+			// When both moved only the first one reports the pair
+			if (q == p || (m_nodes[q].m_moved && q < p))
+				continue;
+			pairs.push_back({ m_nodes[p].m_user, m_nodes[q].m_user });
+		}
+	}
+	for (uint p : m_moved)
+		m_nodes[p].m_moved = false;
+	m_moved.clear();
+}
+uint broadphase::get_height() const
+{
+	return m_root == c_null ? 0u : static_cast<uint>(m_nodes[m_root].m_height);
+}
+void broadphase::clear()
+{
+	m_nodes.clear();
+	m_moved.clear();
+	m_root = c_null;
+	m_free = c_null;
+}
+
+uint broadphase::allocate()
+{
+	uint idx = m_free;
+	if (idx == c_null)
+	{
+		idx = static_cast<uint>(m_nodes.size());
+		m_nodes.push_back({});
+	}
+	else
+		m_free = m_nodes[idx].m_parent;
+	node& n = m_nodes[idx];
+	n.m_parent = c_null;
+	n.m_children[0] = n.m_children[1] = c_null;
+	n.m_user = c_null;
+	n.m_height = 0;
+	n.m_moved = false;
+	return idx;
+}
+void broadphase::release(uint idx)
+{
+	m_nodes[idx].m_height = -1;
+	m_nodes[idx].m_moved = false;
+	m_nodes[idx].m_parent = m_free;
+	m_free = idx;
+}
+/**
+ * Pairs the leaf with the node that grows the tree the least
+**/
+void broadphase::insert_leaf(uint leaf)
+{
+	if (m_root == c_null)
+	{
+		m_root = leaf;
+		m_nodes[leaf].m_parent = c_null;
+		return;
+	}
+	// Descend while a child is cheaper than a new parent here
+	const aabb box = m_nodes[leaf].m_box;
+	uint idx = m_root;
+	while (!m_nodes[idx].is_leaf())
+	{
+		const node& n = m_nodes[idx];
+		const float combined = area(merge(n.m_box, box));
+		const float cost = 2.0f * combined;
+		// Every node below grows with this one
+		const float inheritance = 2.0f * (combined - area(n.m_box));
+		float child_cost[2];
+		for (uint c = 0; c < 2u; ++c)
+		{
+			const node& child = m_nodes[n.m_children[c]];
+			child_cost[c] = area(merge(child.m_box, box)) + inheritance;
+			if (!child.is_leaf())
+				child_cost[c] -= area(child.m_box);
+		}
+		if (cost < child_cost[0] && cost < child_cost[1])
+			break;
+		idx = child_cost[0] < child_cost[1] ? n.m_children[0] : n.m_children[1];
+	}
+	// New parent for the sibling and the leaf
+	const uint sibling = idx;
+	const uint old_parent = m_nodes[sibling].m_parent;
+	const uint parent = allocate();
+	m_nodes[parent].m_parent = old_parent;
+	m_nodes[parent].m_children[0] = sibling;
+	m_nodes[parent].m_children[1] = leaf;
+	m_nodes[sibling].m_parent = parent;
+	m_nodes[leaf].m_parent = parent;
+	if (old_parent == c_null)
+		m_root = parent;
+	else
+	{
+		uint* children = m_nodes[old_parent].m_children;
+		children[children[0] == sibling ? 0 : 1] = parent;
+	}
+	// Fix the boxes and heights up to the root
+	for (idx = parent; idx != c_null; idx = m_nodes[idx].m_parent)
+	{
+		idx = rotate(idx);
+		refit(idx);
+	}
+}
+void broadphase::remove_leaf(uint leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = c_null;
+		return;
+	}
+	// The sibling takes the place of the parent
+	const uint parent = m_nodes[leaf].m_parent;
+	const uint grand_parent = m_nodes[parent].m_parent;
+	const uint sibling = m_nodes[parent].m_children[m_nodes[parent].m_children[0] == leaf ? 1 : 0];
+	m_nodes[sibling].m_parent = grand_parent;
+	release(parent);
+	if (grand_parent == c_null)
+	{
+		m_root = sibling;
+		return;
+	}
+	uint* children = m_nodes[grand_parent].m_children;
+	children[children[0] == parent ? 0 : 1] = sibling;
+	// Fix the boxes and heights up to the root
+	for (uint idx = grand_parent; idx != c_null; idx = m_nodes[idx].m_parent)
+	{
+		idx = rotate(idx);
+		refit(idx);
+	}
+}
+/**
+ * Lifts the taller child if the node is unbalanced, returns the node now in its place
+**/
+uint broadphase::rotate(uint idx)
+{
+	node& a = m_nodes[idx];
+	if (a.is_leaf() || a.m_height < 2)
+		return idx;
+	const int balance = m_nodes[a.m_children[1]].m_height - m_nodes[a.m_children[0]].m_height;
+	if (balance >= -1 && balance <= 1)
+		return idx;
+	// The taller child becomes the parent
+	const uint side = balance > 1 ? 1u : 0u;
+	const uint up = a.m_children[side];
+	node& u = m_nodes[up];
+	const uint f = u.m_children[0];
+	const uint g = u.m_children[1];
+	u.m_children[0] = idx;
+	u.m_parent = a.m_parent;
+	a.m_parent = up;
+	if (u.m_parent == c_null)
+		m_root = up;
+	else
+	{
+		uint* children = m_nodes[u.m_parent].m_children;
+		children[children[0] == idx ? 0 : 1] = up;
+	}
+	// It keeps its taller child, the other one goes down to the old parent
+	const bool keep_f = m_nodes[f].m_height > m_nodes[g].m_height;
+	u.m_children[1] = keep_f ? f : g;
+	a.m_children[side] = keep_f ? g : f;
+	m_nodes[a.m_children[side]].m_parent = idx;
+	refit(idx);
+	refit(up);
+	return up;
+}
+/**
+ * Box and height from the children
+**/
+void broadphase::refit(uint idx)
+{
+	node& n = m_nodes[idx];
+	const node& a = m_nodes[n.m_children[0]];
+	const node& b = m_nodes[n.m_children[1]];
+	n.m_box = merge(a.m_box, b.m_box);
+	n.m_height = 1 + std::max(a.m_height, b.m_height);
+}
@@ -0,0 +1,62 @@
+/**
+ * @file broadphase.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Dynamic bounding volume tree finding the pairs of bodies that may touch
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include "aabb.h"
+#include <vector>
+#include <utility>
+#include <climits>
+
+using uint = unsigned int;
+
+/**
+ * Proxies store a box grown by a margin, so they only move in the tree once the
+ * body leaves it. Only the proxies that moved look for new pairs.
+**/
+class broadphase
+{
+	struct node
+	{
+		aabb m_box;
+		// Next free node while unused
+		uint m_parent;
+		uint m_children[2];
+		uint m_user;
+		// Leaves are 0, free nodes -1
+		int m_height;
+		bool m_moved;
+
+		bool is_leaf()const { return m_children[0] == c_null; }
+	};
+
+	uint allocate();
+	void release(uint idx);
+	void insert_leaf(uint leaf);
+	void remove_leaf(uint leaf);
+	uint rotate(uint idx);
+	void refit(uint idx);
+	std::vector<node> m_nodes;
+	uint m_root{ c_null };
+	uint m_free{ c_null };
+	std::vector<uint> m_moved;
+
+public:
+	static constexpr uint c_null{ UINT_MAX };
+	// Growth of the proxy boxes
+	static constexpr float c_fat_margin{ 0.1f };
+
+	uint add_proxy(const aabb& box, uint user);
+	void remove_proxy(uint proxy);
+	bool move_proxy(uint proxy, const aabb& box);
+	void set_user(uint proxy, uint user);
+	uint get_user(uint proxy)const;
+	const aabb& get_box(uint proxy)const;
+	void query(const aabb& box, std::vector<uint>& out)const;
+	void update_pairs(std::vector<std::pair<uint, uint>>& pairs);
+	uint get_height()const;
+	void clear();
+};
@@ -0,0 +1,126 @@
+/**
+ * @file ccd.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Continuous collision detection by conservative advancement
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "ccd.h"
+#include "body.h"
+#include "physical_mesh.h"
+#include "math_utils.h"
+#include <cfloat>
+
+static const int c_ccd_iterations = 20;
+static const float c_ccd_tolerance = 0.005f;
+
+conservative_advancement::conservative_advancement(const body & bA, const physical_mesh & mA, const body & bB, const physical_mesh & mB)
+	: bA(bA), mA(mA), bB(bB), mB(&mB), m_tri{}, m_radius_A(mA.get_radius()), m_radius_B(mB.get_radius())
+{}
+
+conservative_advancement::conservative_advancement(const body & bA, const physical_mesh & mA, const body & bB, const glm::vec3(&tri)[3])
+	: bA(bA), mA(mA), bB(bB), mB(nullptr), m_tri{ tri[0], tri[1], tri[2] }, m_radius_A(mA.get_radius()), m_radius_B(0.0f)
+{
+	// The triangle may be far from the origin of its body
+	for (int i = 0; i < 3; ++i)
+		m_radius_B = glm::max(m_radius_B, glm::length(tri[i]));
+}
+
+/**
+ * World space support point of B, either a hull or a triangle
+**/
+glm::vec3 conservative_advancement::support_B(const glm::mat4 & BtoW, const glm::vec3 & dir) const
+{
+	if (mB)
+		return tr_point(BtoW, mB->support(glm::transpose(glm::mat3(BtoW)) * dir));
+
+	glm::vec3 best = tr_point(BtoW, m_tri[0]);
+	for (int i = 1; i < 3; ++i)
+	{
+		const glm::vec3 p = tr_point(BtoW, m_tri[i]);
+		if (glm::dot(p, dir) > glm::dot(best, dir))
+			best = p;
+	}
+	return best;
+}
+
+/**
+ * Lower bound of the distance between both shapes: the largest gap
+ * found projecting them on the face normals and the center direction
+**/
+float conservative_advancement::compute_distance(const glm::mat4 & AtoW, const glm::mat4 & BtoW, glm::vec3 & axis) const
+{
+	const glm::mat3 rotA{ AtoW };
+	const glm::mat3 rotB{ BtoW };
+	float best{ -FLT_MAX };
+
+	// Gap between both shapes along a world axis pointing from A to B
+	auto test_axis = [&](glm::vec3 n)
+	{
+		const float len = glm::length(n);
+		if (len < c_epsilon)
+			return;
+		n /= len;
+		const float maxA = glm::dot(tr_point(AtoW, mA.support(glm::transpose(rotA) * n)), n);
+		const float minB = glm::dot(support_B(BtoW, -n), n);
+		if (minB - maxA > best)
+		{
+			best = minB - maxA;
+			axis = n;
+		}
+	};
+
+	// Face normals of A
+	for (const auto& f : mA.m_faces)
+		test_axis(rotA * glm::vec3(f.m_plane));
+	// Face normals of B, pointing towards A
+	if (mB)
+	{
+		for (const auto& f : mB->m_faces)
+			test_axis(-(rotB * glm::vec3(f.m_plane)));
+	}
+	else
+	{
+		const glm::vec3 n = rotB * glm::cross(m_tri[1] - m_tri[0], m_tri[2] - m_tri[0]);
+		test_axis(n);
+		test_axis(-n);
+	}
+	// Direction between both centers
+	test_axis(glm::vec3(BtoW[3]) - glm::vec3(AtoW[3]));
+	return best;
+}
+
+/**
+ * Advances both bodies along their current velocities by steps that can
+ * never skip the contact, returns the time they first overlap by less than
+ * the tolerance, so the contact gets generated next step, or dt if they do
+ * not meet. Pairs already touching return dt, those are handled by the
+ * contact solver.
+**/
+float conservative_advancement::time_of_impact(float dt) const
+{
+	const glm::vec3 vA = bA.get_linear_velocity();
+	const glm::vec3 vB = bB.m_is_static ? glm::vec3{} : bB.get_linear_velocity();
+	// Bound of the speed any point may gain from rotation
+	const float angular_bound = glm::length(bA.get_angular_velocity()) * m_radius_A
+		+ (bB.m_is_static ? 0.0f : glm::length(bB.get_angular_velocity()) * m_radius_B);
+
+	float t{ 0.0f };
+	for (int i = 0; i < c_ccd_iterations; ++i)
+	{
+		glm::vec3 axis{};
+		const float distance = compute_distance(bA.get_predicted_model(t), bB.get_predicted_model(t), axis);
+		// Touching
+		if (distance <= 0.0f)
+			return i == 0 ? dt : t;
+		// Speed at which the gap may close
+		const float speed = glm::dot(vA - vB, axis) + angular_bound;
+		if (speed <= c_epsilon)
+			return dt;
+		// Advance up to the target penetration, the distance is a lower bound so it is never exceeded
+		t += (distance + c_ccd_tolerance) / speed;
+		if (t >= dt)
+			return dt;
+	}
+	return t;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file ccd.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Continuous collision detection by conservative advancement
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include <glm/glm.hpp>
+
+struct body;
+struct physical_mesh;
+
+class conservative_advancement
+{
+	const body& bA;
+	const physical_mesh& mA;
+	const body& bB;
+	const physical_mesh* mB;
+	glm::vec3 m_tri[3];
+	float m_radius_A;
+	float m_radius_B;
+
+	glm::vec3 support_B(const glm::mat4& BtoW, const glm::vec3& dir)const;
+	float compute_distance(const glm::mat4& AtoW, const glm::mat4& BtoW, glm::vec3& axis)const;
+
+public:
+	conservative_advancement(const body& bA, const physical_mesh& mA, const body& bB, const physical_mesh& mB);
+	conservative_advancement(const body& bA, const physical_mesh& mA, const body& bB, const glm::vec3(&tri)[3]);
+	float time_of_impact(float dt)const;
+};
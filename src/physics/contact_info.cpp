@@ -1,6 +1,7 @@
 #include "contact_info.h"
 #include "math_utils.h"
 #include "body.h"
+#include "thread_pool.h"
 
 overlap_pair::overlap_pair(body * bA, body * bB, const physical_mesh * mA, const physical_mesh * mB)
 	:body_A(bA),body_B(bB), mesh_A(mA), mesh_B(mB)
@@ -9,7 +10,7 @@ overlap_pair::overlap_pair(body * bA, body * bB, const physical_mesh * mA, const
 	manifold.oldvec_V = glm::zero<glm::vec3>();
 }
 
-void overlap_pair::update()
+void overlap_pair::update(float dt)
 {
 	manifold.coef_friction = std::sqrtf(body_A->m_friction_coef * body_B->m_friction_coef);
 	manifold.coef_roll = std::fmax(body_A->m_roll_coef, body_B->m_roll_coef);
@@ -21,8 +22,6 @@ void overlap_pair::update()
 	manifold.invI_B = body_B->get_oriented_invinertia();
 	// Get data
 	const glm::vec3 normal = manifold.normal;
-	const glm::vec3 Pos_A = body_A->m_position;
-	const glm::vec3 Pos_B = body_B->m_position;
 	// Get transformation matrices
 	const glm::mat4 AtoW = body_A->get_model();
 	const glm::mat4 BtoW = body_B->get_model();
@@ -37,26 +36,13 @@ void overlap_pair::update()
 		// Compute world position
 		p.point_A = tr_point(AtoW, p.local_A);
 		p.point_B = tr_point(BtoW, p.local_B);
-		p.depth = glm::distance(p.point_A, p.point_B);
-		// Compute R vectors
-		const glm::vec3 R_A = p.point_A - Pos_A;
-		const glm::vec3 R_B = p.point_B - Pos_B;
+		// Signed depth, negative for speculative contacts
+		p.depth = glm::dot(p.point_A - p.point_B, normal);
 		// Accumulate average points
 		manifold.avg_point_A += p.point_A;
 		manifold.avg_point_B += p.point_B;
 
 
-		// Compute inverse mass of velocity constraint
-		const glm::vec3 rAxN = glm::cross(R_A, normal);
-		const glm::vec3 rBxN = glm::cross(R_B, normal);
-		const float eff_mass
-			= manifold.invM_A
-			+ manifold.invM_B
-			+ glm::dot(glm::cross(manifold.invI_A * rAxN, R_A), normal)
-			+ glm::dot(glm::cross(manifold.invI_B * rBxN, R_B), normal);
-		p.invM_Vel = eff_mass > 0.0f ? 1.f / (eff_mass * (float)manifold.points.size()) : 0.0f;
-
-
 		// Compute velocities at contact points
 		const glm::vec3 vpA = body_A->get_velocity_at_point(p.point_A);
 		const glm::vec3 vpB = body_B->get_velocity_at_point(p.point_B);
@@ -64,9 +50,10 @@ void overlap_pair::update()
 		const float Jv0_vel = glm::dot(vpB- vpA, normal);
 
 
-		// Compute restitution bias
+		// Compute restitution bias, speculative contacts
+		// only bounce if they close the gap during this step
 		p.restitution_bias = 0.0f;
-		if (Jv0_vel < -c_rest_vel_threshold)
+		if (Jv0_vel < -c_rest_vel_threshold && (p.depth >= 0.0f || Jv0_vel * dt < p.depth))
 			p.restitution_bias = Jv0_vel * manifold.coef_restitution;
 	}
 
@@ -75,11 +62,6 @@ void overlap_pair::update()
 	float inv_c = 1.0f / static_cast<float>(manifold.points.size());
 	manifold.avg_point_A *= inv_c;
 	manifold.avg_point_B *= inv_c;
-	// Compute R vectors
-	const glm::vec3 R_A = manifold.avg_point_A - Pos_A;
-	const glm::vec3 R_B = manifold.avg_point_B - Pos_B;
-
-
 	// Prepare data for warm start
 	manifold.oldvec_U = manifold.vec_U;
 	manifold.oldvec_V = manifold.vec_V;
@@ -101,6 +83,38 @@ void overlap_pair::update()
 		manifold.vec_U = make_ortho(normal);
 	// Compute second constraint vector
 	manifold.vec_V = glm::normalize(glm::cross(normal, manifold.vec_U));
+	// Compute inverse masses of the constraints
+	update_masses();
+}
+
+/**
+ * Computes the effective masses of the constraints from the masses stored
+ * in the manifold and the current contact points
+**/
+void overlap_pair::update_masses()
+{
+	// Get data
+	const glm::vec3 normal = manifold.normal;
+	const glm::vec3 Pos_A = body_A->m_position;
+	const glm::vec3 Pos_B = body_B->m_position;
+	for (auto& p : manifold.points)
+	{
+		// Compute R vectors
+		const glm::vec3 R_A = p.point_A - Pos_A;
+		const glm::vec3 R_B = p.point_B - Pos_B;
+		// Compute inverse mass of velocity constraint
+		const glm::vec3 rAxN = glm::cross(R_A, normal);
+		const glm::vec3 rBxN = glm::cross(R_B, normal);
+		const float eff_mass
+			= manifold.invM_A
+			+ manifold.invM_B
+			+ glm::dot(glm::cross(manifold.invI_A * rAxN, R_A), normal)
+			+ glm::dot(glm::cross(manifold.invI_B * rBxN, R_B), normal);
+		p.invM_Vel = eff_mass > 0.0f ? 1.f / (eff_mass * (float)manifold.points.size()) : 0.0f;
+	}
+	// Compute R vectors
+	const glm::vec3 R_A = manifold.avg_point_A - Pos_A;
+	const glm::vec3 R_B = manifold.avg_point_B - Pos_B;
 
 
 	// Compute inverse mass of first friction constraint
@@ -145,6 +159,62 @@ void overlap_pair::update()
 	}
 }
 
+/**
+ * Moves the contact points along with the bodies and recomputes their depths,
+ * the rest of the constraint data is kept from the last update()
+**/
+void overlap_pair::update_depths()
+{
+	// Get transformation matrices
+	const glm::mat4 AtoW = body_A->get_model();
+	const glm::mat4 BtoW = body_B->get_model();
+	manifold.avg_point_A = glm::zero<glm::vec3>();
+	manifold.avg_point_B = glm::zero<glm::vec3>();
+	for (auto& p : manifold.points)
+	{
+		// Compute world position
+		p.point_A = tr_point(AtoW, p.local_A);
+		p.point_B = tr_point(BtoW, p.local_B);
+		// Signed depth, negative for speculative contacts
+		p.depth = glm::dot(p.point_A - p.point_B, manifold.normal);
+		// Accumulate average points
+		manifold.avg_point_A += p.point_A;
+		manifold.avg_point_B += p.point_B;
+	}
+	// Compute average points
+	const float inv_c = 1.0f / static_cast<float>(manifold.points.size());
+	manifold.avg_point_A *= inv_c;
+	manifold.avg_point_B *= inv_c;
+}
+
+/**
+ * Keeps the current manifold if the relative transform of the pair changed
+ * less than a tolerance since it was generated, update() refreshes its world
+ * points and depths. A full narrowphase is forced every max_frames frames.
+**/
+bool overlap_pair::reuse_manifold(int max_frames)
+{
+	// Current transform of A in space of B
+	const glm::quat inv_rot_B = glm::conjugate(body_B->m_rotation);
+	const glm::vec3 position = inv_rot_B * (body_A->m_position - body_B->m_position);
+	const glm::quat rotation = inv_rot_B * body_A->m_rotation;
+	// Check the pair barely moved since last full refresh
+	if (m_state == state::Collision && frames_reused < max_frames
+	 && glm::length2(position - rel_position) < c_reuse_distance * c_reuse_distance
+	 && glm::abs(glm::dot(rotation, rel_rotation)) > c_reuse_rotation)
+	{
+		// Rotate the normal along with the pair
+		manifold.normal = body_A->m_rotation * local_normal;
+		++frames_reused;
+		return true;
+	}
+	// Store the transform of the full refresh
+	rel_position = position;
+	rel_rotation = rotation;
+	frames_reused = 0;
+	return false;
+}
+
 void overlap_pair::add_manifold(const sat::simple_manifold & other)
 {
 	assert(other.m_local_A.size() == other.m_local_B.size());
@@ -154,6 +224,8 @@ void overlap_pair::add_manifold(const sat::simple_manifold & other)
 	if (glm::dot(manifold.normal, other.m_normal) > 1.0f - c_epsilon)
 	{
 
+		// Points within the contact margin keep their warm start data
+		const float match_distance = glm::max(margin * margin, c_epsilon);
 		std::vector<contact_point> points;
 		points.reserve(other.m_local_A.size());
 		for (int i = 0; i < other.m_local_A.size(); ++i)
@@ -163,9 +235,9 @@ void overlap_pair::add_manifold(const sat::simple_manifold & other)
 
 			// Check wether the point is already inside
 			bool found{ false };
-			for (const auto prev_p : manifold.points)
-				if (glm::length2(local_A - prev_p.local_A) < c_epsilon
-				 && glm::length2(local_B - prev_p.local_B) < c_epsilon)
+			for (const auto& prev_p : manifold.points)
+				if (glm::length2(local_A - prev_p.local_A) < match_distance
+				 && glm::length2(local_B - prev_p.local_B) < match_distance)
 				{
 					points.push_back(prev_p);
 					found = true;
@@ -193,4 +265,29 @@ void overlap_pair::add_manifold(const sat::simple_manifold & other)
 		manifold.lambda_Twist = 0.0f ;
 		manifold.lambda_Roll = glm::vec3{ 0.0f, 0.0f, 0.0f };
 	}
+	// Store normal in space of A, for reuse
+	local_normal = glm::conjugate(body_A->m_rotation) * manifold.normal;
+}
+
+/**
+ * Prepares the constraints of the pairs before solving, update() or only
+ * update_depths() for substeps. Every pair reads its bodies and writes only
+ * its own manifold, so they run in parallel when given a pool.
+**/
+void prestep_pairs(const std::vector<overlap_pair*>& pairs, bool full, float dt, thread_pool* pool)
+{
+	auto prestep = [&](uint begin, uint end, uint)
+	{
+		for (uint i = begin; i < end; ++i)
+		{
+			if (full)
+				pairs[i]->update(dt);
+			else
+				pairs[i]->update_depths();
+		}
+	};
+	if (pool)
+		pool->parallel_for(static_cast<uint>(pairs.size()), 32u, prestep);
+	else
+		prestep(0u, static_cast<uint>(pairs.size()), 0u);
 }
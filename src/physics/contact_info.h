@@ -1,11 +1,14 @@
 #pragma once
 #include "sat.h"
+#include "body.h"
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <vector>
 
 struct body;
 struct physical_mesh;
 struct physical_mesh;
+class thread_pool;
 
 struct contact_point
 {
@@ -16,6 +19,7 @@ struct contact_point
 	glm::vec3 point_A;
 	glm::vec3 point_B;
 	float lambda_Vel{ 0.0f };
+	float lambda_Pos{ 0.0f };
 	float invM_Vel;
 	float restitution_bias;
 };
@@ -62,9 +66,19 @@ struct overlap_pair
 	const physical_mesh* mesh_B;
 	contact_manifold manifold;
 	mutable sat::penetration_data prev_data{sat::actor::Null};
+	float margin{ 0.0f };
+	glm::vec3 local_normal{ 0.0f, 0.0f, 0.0f };
+	glm::vec3 rel_position{ 0.0f, 0.0f, 0.0f };
+	glm::quat rel_rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+	int frames_reused{ 0 };
 
 	overlap_pair() = default;
 	overlap_pair(body* bA, body* bB, const physical_mesh* mA, const physical_mesh* mB);
-	void update();
+	void update(float dt = physics_dt);
+	void update_masses();
+	void update_depths();
 	void add_manifold(const sat::simple_manifold& other);
-};
\ No newline at end of file
+	bool reuse_manifold(int max_frames);
+};
+
+void prestep_pairs(const std::vector<overlap_pair*>& pairs, bool full, float dt, thread_pool* pool);
@@ -1,12 +1,43 @@
 #include "contact_solver.h"
 #include "body.h"
 #include "math_utils.h"
+#include "thread_pool.h"
+#include "simd.h"
+#include <unordered_map>
+#include <bitset>
+#include <algorithm>
+#include <cfloat>
+#include <functional>
+
+void solver_body::add_impulse(const glm::vec3& impulse, const glm::vec3& point)
+{
+	// Static bodies are shared between threads, never write them
+	if (inv_mass == 0.0f)
+		return;
+	linear_velocity += inv_mass * impulse;
+	angular_velocity += inv_inertia * glm::cross(point - position, impulse);
+}
+
+void solver_body::add_impulse_angular(const glm::vec3& impulse)
+{
+	if (inv_mass == 0.0f)
+		return;
+	angular_velocity += inv_inertia * impulse;
+}
 
 void constraint_contact_solver::evaluate(std::vector<overlap_pair*>& overlaps)
 {
-	// Warm start from previous lambdas
-	for (auto& pair : overlaps)
+	// Cache the velocities of the bodies
+	build_bodies(overlaps);
+	if (m_block)
+		build_block_mass(overlaps);
+	// Warm start from previous lambdas, the relax pass already applied them
+	if (!m_relax)
+	for (uint i = 0; i < overlaps.size(); ++i)
 	{
+		overlap_pair* pair = overlaps[i];
+		solver_body& A = m_bodies[m_pair_bodies[2u * i]];
+		solver_body& B = m_bodies[m_pair_bodies[2u * i + 1u]];
 		contact_manifold& manifold = pair->manifold;
 		bool resting_contact{ false };
 		for (auto& p : pair->manifold.points)
@@ -20,8 +51,8 @@ void constraint_contact_solver::evaluate(std::vector<overlap_pair*>& overlaps)
 			
 				// Apply previous impulse
 				const glm::vec3 dir_impulse = p.lambda_Vel * manifold.normal;
-				pair->body_A->add_impulse(-dir_impulse, p.point_A);
-				pair->body_B->add_impulse(dir_impulse, p.point_B);
+				A.add_impulse(-dir_impulse, p.point_A);
+				B.add_impulse(dir_impulse, p.point_B);
 			}
 			// Reset previous lambdas
 			else
@@ -43,20 +74,20 @@ void constraint_contact_solver::evaluate(std::vector<overlap_pair*>& overlaps)
 				= manifold.lambda_U * manifold.vec_U
 				+ manifold.lambda_V * manifold.vec_V;
 			// Apply previous impulse
-			pair->body_A->add_impulse(-friction_impulse, manifold.avg_point_A);
-			pair->body_B->add_impulse(friction_impulse, manifold.avg_point_B);
+			A.add_impulse(-friction_impulse, manifold.avg_point_A);
+			B.add_impulse(friction_impulse, manifold.avg_point_B);
 
 
 			// Compute previous twist impulse
 			const glm::vec3 friction_impulsetwist = manifold.lambda_Twist * manifold.normal;
 			// Apply previous twist impulse
-			pair->body_A->add_impulse_angular(-friction_impulsetwist);
-			pair->body_B->add_impulse_angular(friction_impulsetwist);
+			A.add_impulse_angular(-friction_impulsetwist);
+			B.add_impulse_angular(friction_impulsetwist);
 
 
 			// Apply previous roll impulse
-			pair->body_A->add_impulse_angular(-manifold.lambda_Roll);
-			pair->body_B->add_impulse_angular(manifold.lambda_Roll);
+			A.add_impulse_angular(-manifold.lambda_Roll);
+			B.add_impulse_angular(manifold.lambda_Roll);
 		}
 		// Reset previous lambdas
 		else
@@ -68,109 +99,996 @@ void constraint_contact_solver::evaluate(std::vector<overlap_pair*>& overlaps)
 		}
 	}
 
-	// For each iteration
-	for (int it = 0; it < m_iteration_count; ++it)
+	// Batches that share no dynamic body, for threads and SIMD lanes.
+	// Mass splitting only needs them for the position pass.
+	std::vector<std::vector<uint>> colors;
+	const bool parallel = m_pool && m_pool->get_thread_count() > 1u;
+	// The wide kernels have no block path, the block solver takes priority
+	const bool wide = m_wide && !m_block;
+	if ((wide && !m_mass_splitting) || (parallel && (!m_mass_splitting || m_position_iteration_count > 0)))
+		color_overlaps(overlaps, colors);
+	m_residuals.clear();
+	// Solve every pair on its own copy of the bodies
+	if (m_mass_splitting)
+		solve_split(overlaps);
+	// Solve packed in SIMD lanes
+	else if (wide)
+		solve_wide(overlaps, colors);
+	// For each iteration, until the lambdas stop changing
+	else for (int it = 0; it < m_iteration_count; ++it)
+	{
+		m_residuals.push_back(sweep(overlaps, colors, &constraint_contact_solver::solve_pair));
+		if (m_residuals.back() < m_tolerance)
+			break;
+	}
+
+
+	// Final pass from the ground up, lower bodies do not react
+	if (m_shock_up != glm::vec3{ 0.0f })
+		shock_propagation(overlaps);
+
+
+	// Split impulse, push penetrating bodies apart with pseudo velocities
+	m_pseudo_velocities.assign(m_position_iteration_count > 0 ? m_bodies.size() : 0u, pseudo_velocity{ glm::vec3{ 0.0f }, glm::vec3{ 0.0f } });
+	for (auto& pair : overlaps)
+	for (auto& p : pair->manifold.points)
+		p.lambda_Pos = 0.0f;
+	for (int it = 0; it < m_position_iteration_count; ++it)
+		if (sweep(overlaps, colors, &constraint_contact_solver::solve_pair_position) < m_tolerance)
+			break;
+	// Write the velocities back to the bodies
+	store_bodies();
+}
+
+/**
+ * One iteration over every pair. Colors run in order and the pairs of a
+ * color in parallel when the pool has threads. Returns the biggest lambda change.
+**/
+float constraint_contact_solver::sweep(const std::vector<overlap_pair*>& overlaps, const std::vector<std::vector<uint>>& colors, float (constraint_contact_solver::*solve)(overlap_pair&, uint))
+{
+	float residual{ 0.0f };
+	// Serial in order
+	if (!m_pool || m_pool->get_thread_count() == 1u)
+	{
+		for (uint i = 0; i < overlaps.size(); ++i)
+			residual = glm::max(residual, (this->*solve)(*overlaps[i], i));
+		return residual;
+	}
+	// Each thread keeps its own maximum
+	std::vector<float> thread_residuals(m_pool->get_thread_count(), 0.0f);
+	for (uint c = 0; c < colors.size(); ++c)
+	{
+		const std::vector<uint>& batch = colors[c];
+		// Last batch holds the pairs that did not fit any color
+		if (c == c_max_colors)
+		{
+			for (uint i : batch)
+				residual = glm::max(residual, (this->*solve)(*overlaps[i], i));
+			continue;
+		}
+		m_pool->parallel_for(static_cast<uint>(batch.size()), 16u, [&](uint begin, uint end, uint thread)
+		{
+			for (uint i = begin; i < end; ++i)
+				thread_residuals[thread] = glm::max(thread_residuals[thread], (this->*solve)(*overlaps[batch[i]], batch[i]));
+		});
+	}
+	for (float r : thread_residuals)
+		residual = glm::max(residual, r);
+	return residual;
+}
+
+/**
+ * Caches the velocities of the bodies of the pairs, once per step
+**/
+void constraint_contact_solver::build_bodies(const std::vector<overlap_pair*>& overlaps)
+{
+	// First body is shared by all the static ones
+	m_owners.assign(1u, nullptr);
+	m_bodies.assign(1u, solver_body{ glm::vec3{ 0.0f }, glm::vec3{ 0.0f }, glm::vec3{ 0.0f }, glm::mat3{ 0.0f }, 0.0f });
+	m_pair_bodies.resize(overlaps.size() * 2u);
+	std::unordered_map<const body*, uint> indices;
+	indices.reserve(overlaps.size() * 2u);
+	for (uint i = 0; i < overlaps.size(); ++i)
 	{
-		// For each pair of overlaps
-		for (auto& pair : overlaps)
+		body* pair_bodies[2]{ overlaps[i]->body_A, overlaps[i]->body_B };
+		for (uint j = 0; j < 2u; ++j)
 		{
-			// Copy previous state data
-			const body bA{ *pair->body_A };
-			const body bB{ *pair->body_B };
-			// Get manifold data
-			contact_manifold& manifold = pair->manifold;
-			const glm::vec3& n = manifold.normal;
-			// Accumulate linear penetration lambdas
-			float accum_lambda = 0.0;
+			body* b = pair_bodies[j];
+			// Static bodies never move, their position is not needed
+			if (b->m_is_static)
+			{
+				m_pair_bodies[2u * i + j] = 0u;
+				continue;
+			}
+			auto it = indices.emplace(b, static_cast<uint>(m_bodies.size()));
+			if (it.second)
+			{
+				const glm::mat3 inv_inertia = b->get_oriented_invinertia();
+				m_owners.push_back(b);
+				m_bodies.push_back(solver_body{ b->m_position, b->get_invmass() * b->m_linear_momentum, inv_inertia * b->m_angular_momentum, inv_inertia, b->get_invmass() });
+			}
+			m_pair_bodies[2u * i + j] = it.first->second;
+		}
+	}
+}
+
+/**
+ * Writes the solved velocities back to the momenta of the bodies
+**/
+void constraint_contact_solver::store_bodies() const
+{
+	for (uint i = 0; i < m_bodies.size(); ++i)
+	{
+		body* b = m_owners[i];
+		if (b == nullptr)
+			continue;
+		const solver_body& sb = m_bodies[i];
+		b->m_linear_momentum = sb.linear_velocity * b->get_mass();
+		if (glm::determinant(sb.inv_inertia) != 0.0f)
+			b->m_angular_momentum = glm::inverse(sb.inv_inertia) * sb.angular_velocity;
+		// Sleep state is left to the islands, only awake ones are solved
+		// Apply the position correction
+		if (m_pseudo_velocities.empty())
+			continue;
+		const pseudo_velocity& pv = m_pseudo_velocities[i];
+		const glm::quat w_quat{ 0.0f, pv.angular.x, pv.angular.y, pv.angular.z };
+		b->m_position += pv.linear * m_dt;
+		b->m_rotation = glm::normalize(b->m_rotation + .5f * w_quat * b->m_rotation * m_dt);
+	}
+}
 
+/**
+ * Greedy coloring of the contact graph: pairs of the same color never
+ * share a dynamic body. Static bodies are never written, so they do not count.
+**/
+void constraint_contact_solver::color_overlaps(const std::vector<overlap_pair*>& overlaps, std::vector<std::vector<uint>>& colors) const
+{
+	// Colors used by each solver body, the static one is never written
+	std::vector<uint64_t> used(m_bodies.size(), 0u);
+	colors.clear();
+	for (uint i = 0; i < overlaps.size(); ++i)
+	{
+		const uint A = m_pair_bodies[2u * i];
+		const uint B = m_pair_bodies[2u * i + 1u];
+		const uint64_t mask = (A ? used[A] : 0u) | (B ? used[B] : 0u);
+		// Find first free color
+		uint color{ 0u };
+		while (color < c_max_colors && (mask & (uint64_t(1) << color)))
+			++color;
+		if (color < c_max_colors)
+		{
+			if (A)
+				used[A] |= uint64_t(1) << color;
+			if (B)
+				used[B] |= uint64_t(1) << color;
+		}
+		// Add to its batch
+		if (colors.size() <= color)
+			colors.resize(color + 1u);
+		colors[color].push_back(i);
+	}
+}
 
-			// For each contact point in the manifold
-			for (auto& point : manifold.points)
+/**
+ * Velocity bias of a contact point: penetration recovery and restitution
+**/
+float constraint_contact_solver::contact_bias(const contact_point& point) const
+{
+	// Compute penetration bias
+	float penetration_bias;
+	// Speculative contact -> allow closing the gap this step,
+	// unless it is closing fast enough to bounce already
+	if (point.depth < 0.0f)
+		penetration_bias = point.restitution_bias < 0.0f ? 0.0f : -point.depth / m_dt;
+	// Split impulse corrects the penetration in the position pass,
+	// relaxing removes the velocity left by the bias
+	else if (m_position_iteration_count > 0 || m_relax)
+		penetration_bias = 0.0f;
+	else
+	{
+		const float extra_depth = point.depth - c_depth_threshold;
+		penetration_bias = -m_baumgarte * extra_depth / m_dt;
+	}
+	// Compute total bias
+	return penetration_bias + point.restitution_bias;
+}
+
+/**
+ * Effective mass matrix coupling the normal constraints of every point
+ * of a manifold, K_ij = J_i M^-1 J_j^T
+**/
+void constraint_contact_solver::build_block_mass(const std::vector<overlap_pair*>& overlaps)
+{
+	m_block_mass.resize(overlaps.size());
+	for (uint i = 0; i < overlaps.size(); ++i)
+		build_pair_block_mass(*overlaps[i], i);
+}
+void constraint_contact_solver::build_pair_block_mass(const overlap_pair& pair, uint index)
+{
+	const contact_manifold& manifold = pair.manifold;
+	const uint count = static_cast<uint>(manifold.points.size());
+	if (count < 2u || count > c_max_block_points)
+		return;
+	const solver_body& A = m_bodies[m_pair_bodies[2u * index]];
+	const solver_body& B = m_bodies[m_pair_bodies[2u * index + 1u]];
+	// Angular jacobians
+	glm::vec3 rA_x_n[c_max_block_points];
+	glm::vec3 rB_x_n[c_max_block_points];
+	for (uint p = 0; p < count; ++p)
+	{
+		rA_x_n[p] = glm::cross(manifold.points[p].point_A - A.position, manifold.normal);
+		rB_x_n[p] = glm::cross(manifold.points[p].point_B - B.position, manifold.normal);
+	}
+	glm::mat4& K = m_block_mass[index];
+	K = glm::mat4{ 0.0f };
+	for (uint r = 0; r < count; ++r)
+	for (uint c = r; c < count; ++c)
+	{
+		K[c][r] = K[r][c]
+			= A.inv_mass + B.inv_mass
+			+ glm::dot(rA_x_n[r], A.inv_inertia * rA_x_n[c])
+			+ glm::dot(rB_x_n[r], B.inv_inertia * rB_x_n[c]);
+	}
+	// Four points on a face only constrain three degrees of freedom, the
+	// small regularization picks the even solution instead of failing
+	float diagonal{ 0.0f };
+	for (uint p = 0; p < count; ++p)
+		diagonal = glm::max(diagonal, K[p][p]);
+	for (uint p = 0; p < count; ++p)
+		K[p][p] += c_block_regularization * diagonal;
+}
+
+/**
+ * Solves the square system K x = b for the rows in the mask with gaussian
+ * elimination, fails if the rows are dependent
+**/
+static bool solve_block_system(const glm::mat4& K, const float (&b)[4], uint count, uint mask, float (&x)[4])
+{
+	// Gather the rows of the system
+	uint rows[4];
+	uint n{ 0u };
+	for (uint i = 0; i < count; ++i)
+		if (mask & (1u << i))
+			rows[n++] = i;
+	float M[4][5];
+	float scale{ 0.0f };
+	for (uint r = 0; r < n; ++r)
+	{
+		for (uint c = 0; c < n; ++c)
+			M[r][c] = K[rows[c]][rows[r]];
+		M[r][n] = b[rows[r]];
+		scale = glm::max(scale, glm::abs(M[r][r]));
+	}
+	// Eliminate with partial pivoting
+	for (uint c = 0; c < n; ++c)
+	{
+		uint pivot = c;
+		for (uint r = c + 1; r < n; ++r)
+			if (glm::abs(M[r][c]) > glm::abs(M[pivot][c]))
+				pivot = r;
+		if (glm::abs(M[pivot][c]) <= c_epsilon * scale)
+			return false;
+		if (pivot != c)
+			for (uint k = 0; k <= n; ++k)
+				std::swap(M[c][k], M[pivot][k]);
+		for (uint r = c + 1; r < n; ++r)
+		{
+			const float f = M[r][c] / M[c][c];
+			for (uint k = c; k <= n; ++k)
+				M[r][k] -= f * M[c][k];
+		}
+	}
+	// Back substitution
+	for (uint i = 0; i < 4; ++i)
+		x[i] = 0.0f;
+	for (uint r = n; r-- > 0;)
+	{
+		float sum = M[r][n];
+		for (uint c = r + 1; c < n; ++c)
+			sum -= M[r][c] * x[rows[c]];
+		x[rows[r]] = sum / M[r][r];
+	}
+	return true;
+}
+
+/**
+ * Solves the normal impulses of all the points of the manifold at once.
+ * Tries every set of active points, biggest first, until one satisfies the
+ * complementarity conditions: lambda >= 0, relative velocity >= 0 and one
+ * of them zero on each point. Fails if there is none. The biggest lambda
+ * change is added to the residual.
+**/
+bool constraint_contact_solver::solve_block(overlap_pair& pair, uint index, float& residual)
+{
+	contact_manifold& manifold = pair.manifold;
+	const uint count = static_cast<uint>(manifold.points.size());
+	if (count < 2u || count > c_max_block_points)
+		return false;
+	solver_body& A = m_bodies[m_pair_bodies[2u * index]];
+	solver_body& B = m_bodies[m_pair_bodies[2u * index + 1u]];
+	const glm::mat4& K = m_block_mass[index];
+	const glm::vec3& n = manifold.normal;
+
+
+	// Velocity error of each point without the current lambdas: b = Jv + bias - K a
+	float old_lambda[4]{};
+	float b[4]{};
+	for (uint p = 0; p < count; ++p)
+	{
+		const contact_point& point = manifold.points[p];
+		const glm::vec3 vpA = A.linear_velocity + glm::cross(A.angular_velocity, point.point_A - A.position);
+		const glm::vec3 vpB = B.linear_velocity + glm::cross(B.angular_velocity, point.point_B - B.position);
+		old_lambda[p] = point.lambda_Vel;
+		b[p] = glm::dot(vpB - vpA, n) + contact_bias(point);
+	}
+	for (uint r = 0; r < count; ++r)
+	for (uint c = 0; c < count; ++c)
+		b[r] -= K[c][r] * old_lambda[c];
+	float minus_b[4];
+	for (uint p = 0; p < 4; ++p)
+		minus_b[p] = -b[p];
+
+
+	// Try the active sets from all the points to none
+	const uint full = (1u << count) - 1u;
+	for (uint active = count + 1u; active-- > 0u;)
+	for (uint mask = full + 1u; mask-- > 0u;)
+	{
+		if (std::bitset<c_max_block_points>(mask).count() != active)
+			continue;
+		// Active points have zero relative velocity
+		float x[4]{};
+		if (mask && !solve_block_system(K, minus_b, count, mask, x))
+			continue;
+		// Impulses must push
+		bool valid{ true };
+		for (uint p = 0; p < count && valid; ++p)
+			valid = x[p] >= 0.0f;
+		// Inactive points must not approach
+		for (uint r = 0; r < count && valid; ++r)
+		{
+			if (mask & (1u << r))
+				continue;
+			float w = b[r];
+			for (uint c = 0; c < count; ++c)
+				w += K[c][r] * x[c];
+			valid = w >= -c_epsilon;
+		}
+		if (!valid)
+			continue;
+
+
+		// Apply the impulse differential
+		for (uint p = 0; p < count; ++p)
+		{
+			contact_point& point = manifold.points[p];
+			const glm::vec3 dir_impulse = (x[p] - old_lambda[p]) * n;
+			residual = glm::max(residual, glm::abs(x[p] - old_lambda[p]));
+			point.lambda_Vel = x[p];
+			A.add_impulse(-dir_impulse, point.point_A);
+			B.add_impulse(dir_impulse, point.point_B);
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * One iteration of the split impulse position constraints of a pair,
+ * only penetration beyond the threshold is corrected. Returns the biggest
+ * lambda change.
+**/
+float constraint_contact_solver::solve_pair_position(overlap_pair& pair, uint index)
+{
+	const uint index_A = m_pair_bodies[2u * index];
+	const uint index_B = m_pair_bodies[2u * index + 1u];
+	const solver_body& A = m_bodies[index_A];
+	const solver_body& B = m_bodies[index_B];
+	pseudo_velocity& pA = m_pseudo_velocities[index_A];
+	pseudo_velocity& pB = m_pseudo_velocities[index_B];
+	// Pseudo velocities before this pair
+	const pseudo_velocity start_A = pA;
+	const pseudo_velocity start_B = pB;
+	const glm::vec3& n = pair.manifold.normal;
+	float residual{ 0.0f };
+
+
+	// For each contact point in the manifold
+	for (auto& point : pair.manifold.points)
+	{
+		const float extra_depth = point.depth - c_depth_threshold;
+		if (extra_depth <= 0.0f)
+			continue;
+		// Compute pseudo velocities at contact points
+		const glm::vec3 R_A = point.point_A - A.position;
+		const glm::vec3 R_B = point.point_B - B.position;
+		const glm::vec3 vpA = start_A.linear + glm::cross(start_A.angular, R_A);
+		const glm::vec3 vpB = start_B.linear + glm::cross(start_B.angular, R_B);
+		// Separate at the velocity that removes part of the penetration this step
+		const float Jv_pos = glm::dot(vpB - vpA, n);
+		const float target = m_baumgarte * extra_depth / m_dt;
+		// Apply lambda differential
+		const float old_lambda = point.lambda_Pos;
+		point.lambda_Pos = glm::max(point.lambda_Pos + point.invM_Vel * (target - Jv_pos), 0.0f);
+		const glm::vec3 impulse = (point.lambda_Pos - old_lambda) * n;
+		residual = glm::max(residual, glm::abs(point.lambda_Pos - old_lambda));
+		// Apply delta impulse, static bodies are never written
+		if (A.inv_mass > 0.0f)
+		{
+			pA.linear -= A.inv_mass * impulse;
+			pA.angular -= A.inv_inertia * glm::cross(R_A, impulse);
+		}
+		if (B.inv_mass > 0.0f)
+		{
+			pB.linear += B.inv_mass * impulse;
+			pB.angular += B.inv_inertia * glm::cross(R_B, impulse);
+		}
+	}
+	return residual;
+}
+
+/**
+ * Solves the pairs once more in order of height, the lower body of each pair
+ * acting as if it had infinite mass. Support then reaches the top of a stack
+ * in a single pass instead of one body per iteration.
+**/
+void constraint_contact_solver::shock_propagation(const std::vector<overlap_pair*>& overlaps)
+{
+	// Height of the lower body of each pair, static bodies are the lowest
+	std::vector<float> heights(overlaps.size());
+	for (uint i = 0; i < overlaps.size(); ++i)
+	{
+		const uint A = m_pair_bodies[2u * i];
+		const uint B = m_pair_bodies[2u * i + 1u];
+		heights[i] = (A == 0u || B == 0u) ? -FLT_MAX
+			: glm::min(glm::dot(m_bodies[A].position, m_shock_up), glm::dot(m_bodies[B].position, m_shock_up));
+	}
+	std::vector<uint> order(overlaps.size());
+	for (uint i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&heights](uint a, uint b) { return heights[a] < heights[b]; });
+
+
+	for (uint i : order)
+	{
+		overlap_pair& pair = *overlaps[i];
+		const uint A = m_pair_bodies[2u * i];
+		const uint B = m_pair_bodies[2u * i + 1u];
+		// Static bodies already have infinite mass
+		if (A == 0u || B == 0u)
+		{
+			solve_pair(pair, i);
+			continue;
+		}
+		// Freeze the lower body
+		const bool lower_A = glm::dot(m_bodies[A].position, m_shock_up) <= glm::dot(m_bodies[B].position, m_shock_up);
+		solver_body& lower = m_bodies[lower_A ? A : B];
+		float& manifold_inv_mass = lower_A ? pair.manifold.invM_A : pair.manifold.invM_B;
+		glm::mat3& manifold_inv_inertia = lower_A ? pair.manifold.invI_A : pair.manifold.invI_B;
+		const solver_body frozen = lower;
+		const float manifold_frozen_mass = manifold_inv_mass;
+		const glm::mat3 manifold_frozen_inertia = manifold_inv_inertia;
+		lower.inv_mass = 0.0f;
+		lower.inv_inertia = glm::mat3{ 0.0f };
+		manifold_inv_mass = 0.0f;
+		manifold_inv_inertia = glm::mat3{ 0.0f };
+		pair.update_masses();
+		if (m_block)
+			build_pair_block_mass(pair, i);
+		// Solve
+		solve_pair(pair, i);
+		// Restore the lower body
+		lower.inv_mass = frozen.inv_mass;
+		lower.inv_inertia = frozen.inv_inertia;
+		manifold_inv_mass = manifold_frozen_mass;
+		manifold_inv_inertia = manifold_frozen_inertia;
+		pair.update_masses();
+		if (m_block)
+			build_pair_block_mass(pair, i);
+	}
+}
+
+/**
+ * Jacobi iterations with mass splitting. Each pair gets a copy of its dynamic
+ * bodies with the mass divided by the number of pairs touching them, so the
+ * pairs share nothing and all run in parallel. After each iteration the
+ * velocities of the copies of a body are averaged.
+**/
+void constraint_contact_solver::solve_split(const std::vector<overlap_pair*>& overlaps)
+{
+	const uint body_count = static_cast<uint>(m_bodies.size());
+	const uint pair_count = static_cast<uint>(overlaps.size());
+	// Copies of each body, as offsets into the list of copies
+	std::vector<uint> copy_begin(body_count + 1u, 0u);
+	for (uint c = 0; c < 2u * pair_count; ++c)
+		++copy_begin[m_pair_bodies[c] + 1u];
+	for (uint b = 0; b < body_count; ++b)
+		copy_begin[b + 1u] += copy_begin[b];
+	std::vector<uint> copies(2u * pair_count);
+	std::vector<uint> next(copy_begin.begin(), copy_begin.end() - 1);
+	// Copies go after the bodies, static bodies keep the shared one
+	const std::vector<uint> owners = m_pair_bodies;
+	m_bodies.resize(body_count + 2u * pair_count);
+	for (uint c = 0; c < 2u * pair_count; ++c)
+	{
+		const uint owner = owners[c];
+		if (owner == 0u)
+			continue;
+		const float split = static_cast<float>(copy_begin[owner + 1u] - copy_begin[owner]);
+		solver_body& copy = m_bodies[body_count + c];
+		copy = m_bodies[owner];
+		copy.inv_mass *= split;
+		copy.inv_inertia *= split;
+		copies[next[owner]++] = body_count + c;
+		m_pair_bodies[c] = body_count + c;
+	}
+	// Effective masses with the split masses
+	auto for_pairs = [&](const std::function<void(uint, uint, uint)>& fn)
+	{
+		if (m_pool)
+			m_pool->parallel_for(pair_count, 32u, fn);
+		else
+			fn(0u, pair_count, 0u);
+	};
+	auto for_bodies = [&](const std::function<void(uint, uint, uint)>& fn)
+	{
+		if (m_pool)
+			m_pool->parallel_for(body_count, 32u, fn);
+		else
+			fn(0u, body_count, 0u);
+	};
+	for_pairs([&](uint begin, uint end, uint) { set_split_masses(overlaps, begin, end); });
+
+
+	// For each iteration, until the lambdas stop changing
+	std::vector<float> thread_residuals(m_pool ? m_pool->get_thread_count() : 1u);
+	for (int it = 0; it < m_iteration_count; ++it)
+	{
+		// Every pair only writes its own copies
+		std::fill(thread_residuals.begin(), thread_residuals.end(), 0.0f);
+		for_pairs([&](uint begin, uint end, uint thread)
+		{
+			for (uint i = begin; i < end; ++i)
+				thread_residuals[thread] = glm::max(thread_residuals[thread], solve_pair(*overlaps[i], i));
+		});
+		// Average the copies of each body and share the result
+		for_bodies([&](uint begin, uint end, uint)
+		{
+			for (uint b = glm::max(begin, 1u); b < end; ++b)
 			{
-				// Compute velocities at contact points
-				const glm::vec3 vpA = bA.get_velocity_at_point(point.point_A);
-				const glm::vec3 vpB = bB.get_velocity_at_point(point.point_B);
-				
+				const uint first = copy_begin[b];
+				const uint last = copy_begin[b + 1u];
+				if (first == last)
+					continue;
+				glm::vec3 linear{ 0.0f };
+				glm::vec3 angular{ 0.0f };
+				for (uint c = first; c < last; ++c)
+				{
+					linear += m_bodies[copies[c]].linear_velocity;
+					angular += m_bodies[copies[c]].angular_velocity;
+				}
+				const float inv_count = 1.0f / static_cast<float>(last - first);
+				m_bodies[b].linear_velocity = linear * inv_count;
+				m_bodies[b].angular_velocity = angular * inv_count;
+				for (uint c = first; c < last; ++c)
+				{
+					m_bodies[copies[c]].linear_velocity = m_bodies[b].linear_velocity;
+					m_bodies[copies[c]].angular_velocity = m_bodies[b].angular_velocity;
+				}
+			}
+		});
+		float residual{ 0.0f };
+		for (float r : thread_residuals)
+			residual = glm::max(residual, r);
+		m_residuals.push_back(residual);
+		if (residual < m_tolerance)
+			break;
+	}
+
+
+	// Back to the real bodies and masses
+	m_pair_bodies = owners;
+	m_bodies.resize(body_count);
+	for_pairs([&](uint begin, uint end, uint) { set_split_masses(overlaps, begin, end); });
+}
+
+/**
+ * Copies the masses of the solver bodies of the pairs into their manifolds
+ * and recomputes the effective masses, block ones included
+**/
+void constraint_contact_solver::set_split_masses(const std::vector<overlap_pair*>& overlaps, uint begin, uint end)
+{
+	for (uint i = begin; i < end; ++i)
+	{
+		overlap_pair& pair = *overlaps[i];
+		const solver_body& A = m_bodies[m_pair_bodies[2u * i]];
+		const solver_body& B = m_bodies[m_pair_bodies[2u * i + 1u]];
+		pair.manifold.invM_A = A.inv_mass;
+		pair.manifold.invM_B = B.inv_mass;
+		pair.manifold.invI_A = A.inv_inertia;
+		pair.manifold.invI_B = B.inv_inertia;
+		pair.update_masses();
+		if (m_block)
+			build_pair_block_mass(pair, i);
+	}
+}
+
+/**
+ * One iteration of the velocity constraints of a pair, returns the biggest lambda change
+**/
+float constraint_contact_solver::solve_pair(overlap_pair & pair, uint index)
+{
+	solver_body& A = m_bodies[m_pair_bodies[2u * index]];
+	solver_body& B = m_bodies[m_pair_bodies[2u * index + 1u]];
+	// Velocities before this pair
+	const glm::vec3 vA = A.linear_velocity;
+	const glm::vec3 vB = B.linear_velocity;
+	const glm::vec3 wA = A.angular_velocity;
+	const glm::vec3 wB = B.angular_velocity;
+	// Get manifold data
+	contact_manifold& manifold = pair.manifold;
+	const glm::vec3& n = manifold.normal;
+	// Accumulate linear penetration lambdas
+	float accum_lambda = 0.0;
+	float residual{ 0.0f };
+
+
+	// Solve the points together if possible, one by one otherwise
+	if (!m_block || !solve_block(pair, index, residual))
+	for (auto& point : manifold.points)
+	{
+		// Compute velocities at contact points
+		const glm::vec3 vpA = vA + glm::cross(wA, point.point_A - A.position);
+		const glm::vec3 vpB = vB + glm::cross(wB, point.point_B - B.position);
+		// Compute total bias
+		const float b = contact_bias(point);
+
+
+		// Compute Jv of the constraint
+		const float Jv_vel = glm::dot(vpB - vpA, n);
+
+		// Store previous state
+		const float old_lambda = point.lambda_Vel;
+		// Compute lambda differential
+		float delta_lambda = point.invM_Vel * -(Jv_vel + b);
+		// Apply lambda differential
+		point.lambda_Vel = glm::max(point.lambda_Vel + delta_lambda, 0.0f);
+		// Compute real lambda differential
+		delta_lambda = point.lambda_Vel - old_lambda;
+		residual = glm::max(residual, glm::abs(delta_lambda));
+
 
-				// Compute penetration bias
-				const float extra_depth = point.depth - c_depth_threshold;
-				const float penetration_bias = -m_baumgarte * extra_depth / physics_dt;
-				// Compute total bias
-				const float b = penetration_bias + point.restitution_bias;
+		// Apply delta impulse
+		const glm::vec3 dir_impulse = delta_lambda * n;
+		A.add_impulse(-dir_impulse, point.point_A);
+		B.add_impulse(dir_impulse, point.point_B);
+	}
+
+
+	// Accumulate linear penetration lambdas
+	for (auto& point : manifold.points)
+		accum_lambda += point.lambda_Vel;
+
+
+	// Compute velocities at friction points
+	const glm::vec3 vfA = vA + glm::cross(wA, manifold.avg_point_A - A.position);
+	const glm::vec3 vfB = vB + glm::cross(wB, manifold.avg_point_B - B.position);
+	// Compute maximum friction limit
+	const float max_friction_lambda = manifold.coef_friction * accum_lambda;
+	const float max_roll_lambda = manifold.coef_roll * accum_lambda;
+	
+	
+	// Compute Jv of the constraint
+	const float     Jv_u     = glm::dot(vfB - vfA, manifold.vec_U);
+	const float     Jv_v     = glm::dot(vfB - vfA, manifold.vec_V);
+	const float     Jv_twist = glm::dot(wB - wA, n);
+	const glm::vec3 Jv_roll  = wB - wA;
+	// Store previous state
+	const float     old_lambda_u     = manifold.lambda_U;
+	const float     old_lambda_v     = manifold.lambda_V;
+	const float     old_lambda_twist = manifold.lambda_Twist;
+	const glm::vec3 old_lambda_roll  = manifold.lambda_Roll;
+	// Compute lambda differential
+	float     delta_lambda_u     = manifold.invM_U     * -Jv_u;
+	float     delta_lambda_v     = manifold.invM_V     * -Jv_v;
+	float     delta_lambda_twist = manifold.invM_Twist * -Jv_twist;
+	glm::vec3 delta_lambda_roll  = manifold.invM_Roll  * -Jv_roll;
+	// Apply lambda differential
+	manifold.lambda_U     = glm::clamp(manifold.lambda_U     + delta_lambda_u,     -max_friction_lambda, max_friction_lambda);
+	manifold.lambda_V     = glm::clamp(manifold.lambda_V     + delta_lambda_v,     -max_friction_lambda, max_friction_lambda);
+	manifold.lambda_Twist = glm::clamp(manifold.lambda_Twist + delta_lambda_twist, -max_friction_lambda, max_friction_lambda);
+	manifold.lambda_Roll  = glm::clamp(manifold.lambda_Roll  + delta_lambda_roll,  -max_roll_lambda,     max_roll_lambda);
+	// Compute real lambda differential
+	delta_lambda_u     = manifold.lambda_U     - old_lambda_u;
+	delta_lambda_v     = manifold.lambda_V     - old_lambda_v;
+	delta_lambda_twist = manifold.lambda_Twist - old_lambda_twist;
+	delta_lambda_roll  = manifold.lambda_Roll  - old_lambda_roll;
+	
+	
+	// Compute friction impulses
+	const glm::vec3 impulse_linear
+		= delta_lambda_u * manifold.vec_U
+		+ delta_lambda_v * manifold.vec_V;
+	const glm::vec3 impulse_angular = delta_lambda_twist * n + delta_lambda_roll;
+	// Apply impulses
+	A.add_impulse(-impulse_linear, manifold.avg_point_A);
+	B.add_impulse(impulse_linear, manifold.avg_point_B);
+	A.add_impulse_angular(-impulse_angular);
+	B.add_impulse_angular(impulse_angular);
+	// Friction changes count as well
+	const glm::vec3 roll_residual = glm::abs(delta_lambda_roll);
+	residual = glm::max(residual, glm::max(glm::abs(delta_lambda_u), glm::abs(delta_lambda_v)));
+	residual = glm::max(residual, glm::abs(delta_lambda_twist));
+	return glm::max(residual, glm::max(roll_residual.x, glm::max(roll_residual.y, roll_residual.z)));
+}
+
+// Normal constraint of one contact point of every lane
+struct wide_contact_row
+{
+	wide_vec3 rA_x_n;
+	wide_vec3 rB_x_n;
+	wide_vec3 invI_rA_x_n;
+	wide_vec3 invI_rB_x_n;
+	wide_float inv_mass;
+	wide_float bias;
+	wide_float lambda;
+};
+
+// Pairs packed in lanes, no dynamic body is shared between lanes
+struct wide_contact_batch
+{
+	overlap_pair* pairs[c_simd_lanes]{};
+	uint body_A[c_simd_lanes]{};
+	uint body_B[c_simd_lanes]{};
+	uint row_begin{ 0u };
+	uint row_count{ 0u };
+
+	wide_vec3 normal;
+	wide_float invM_A;
+	wide_float invM_B;
+	wide_mat3 invI_A;
+	wide_mat3 invI_B;
+
+	wide_vec3 avg_R_A;
+	wide_vec3 avg_R_B;
+	wide_vec3 vec_U;
+	wide_vec3 vec_V;
+	wide_float invM_U;
+	wide_float invM_V;
+	wide_float invM_Twist;
+	wide_mat3 invM_Roll;
+	wide_float coef_friction;
+	wide_float coef_roll;
+	wide_float lambda_U;
+	wide_float lambda_V;
+	wide_float lambda_Twist;
+	wide_vec3 lambda_Roll;
+};
 
+/**
+ * Same iteration as solve_pair for every lane of the batch, returns the
+ * biggest lambda change of each lane
+**/
+static wide_float solve_wide_batch(wide_contact_batch& batch, wide_contact_row* rows, std::vector<solver_body>& bodies)
+{
+	// Gather the velocities of the lanes
+	wide_vec3 vA, wA, vB, wB;
+	for (uint l = 0; l < c_simd_lanes; ++l)
+	{
+		vA.set(l, bodies[batch.body_A[l]].linear_velocity);
+		wA.set(l, bodies[batch.body_A[l]].angular_velocity);
+		vB.set(l, bodies[batch.body_B[l]].linear_velocity);
+		wB.set(l, bodies[batch.body_B[l]].angular_velocity);
+	}
+	const wide_vec3& n = batch.normal;
+	const wide_float zero{};
+	// Accumulated impulses, applied once all the rows are solved
+	wide_float accum_lambda;
+	wide_float residual;
+	wide_float normal_impulse;
+	wide_vec3 angular_A, angular_B;
 
-				// Compute Jv of the constraint
-				const float Jv_vel = glm::dot(vpB - vpA, n);
 
-				// Store previous state
-				const float old_lambda = point.lambda_Vel;
-				// Compute lambda differential
-				float delta_lambda = point.invM_Vel * -(Jv_vel + b);
-				// Apply lambda differential
-				point.lambda_Vel = glm::max(point.lambda_Vel + delta_lambda, 0.0f);
-				// Compute real lambda differential
-				delta_lambda = point.lambda_Vel - old_lambda;
+	// For each contact point of the lanes
+	const wide_float Jv_linear = dot(vB - vA, n);
+	for (uint r = 0; r < batch.row_count; ++r)
+	{
+		wide_contact_row& row = rows[r];
+		// Compute Jv of the constraint
+		const wide_float Jv_vel = Jv_linear + dot(wB, row.rB_x_n) - dot(wA, row.rA_x_n);
+		// Apply lambda differential
+		const wide_float old_lambda = row.lambda;
+		row.lambda = wide_max(row.lambda - row.inv_mass * (Jv_vel + row.bias), zero);
+		// Compute real lambda differential
+		const wide_float delta_lambda = row.lambda - old_lambda;
+		residual = wide_max(residual, wide_abs(delta_lambda));
+		accum_lambda = accum_lambda + row.lambda;
+		// Accumulate delta impulse
+		normal_impulse = normal_impulse + delta_lambda;
+		angular_A = angular_A + delta_lambda * row.invI_rA_x_n;
+		angular_B = angular_B + delta_lambda * row.invI_rB_x_n;
+	}
 
 
-				// Accumulate linear penetration lambdas
-				accum_lambda += point.lambda_Vel;
+	// Compute Jv of the friction constraints
+	const wide_vec3 vfA = vA + cross(wA, batch.avg_R_A);
+	const wide_vec3 vfB = vB + cross(wB, batch.avg_R_B);
+	const wide_vec3 Jv_roll = wB - wA;
+	const wide_float Jv_u = dot(vfB - vfA, batch.vec_U);
+	const wide_float Jv_v = dot(vfB - vfA, batch.vec_V);
+	const wide_float Jv_twist = dot(Jv_roll, n);
+	// Compute maximum friction limit
+	const wide_float max_friction = batch.coef_friction * accum_lambda;
+	const wide_float max_roll = batch.coef_roll * accum_lambda;
+	const wide_vec3 max_roll3{ max_roll, max_roll, max_roll };
+	const wide_vec3 min_roll3{ -max_roll, -max_roll, -max_roll };
+	// Store previous state
+	const wide_float old_lambda_u = batch.lambda_U;
+	const wide_float old_lambda_v = batch.lambda_V;
+	const wide_float old_lambda_twist = batch.lambda_Twist;
+	const wide_vec3 old_lambda_roll = batch.lambda_Roll;
+	// Apply lambda differential
+	batch.lambda_U = wide_clamp(batch.lambda_U - batch.invM_U * Jv_u, -max_friction, max_friction);
+	batch.lambda_V = wide_clamp(batch.lambda_V - batch.invM_V * Jv_v, -max_friction, max_friction);
+	batch.lambda_Twist = wide_clamp(batch.lambda_Twist - batch.invM_Twist * Jv_twist, -max_friction, max_friction);
+	batch.lambda_Roll = wide_clamp(batch.lambda_Roll - batch.invM_Roll * Jv_roll, min_roll3, max_roll3);
+	// Compute friction impulses
+	const wide_vec3 impulse_linear
+		= (batch.lambda_U - old_lambda_u) * batch.vec_U
+		+ (batch.lambda_V - old_lambda_v) * batch.vec_V;
+	const wide_vec3 delta_lambda_roll = batch.lambda_Roll - old_lambda_roll;
+	const wide_vec3 impulse_angular = (batch.lambda_Twist - old_lambda_twist) * n + delta_lambda_roll;
+	// Friction changes count as well
+	residual = wide_max(residual, wide_max(wide_abs(batch.lambda_U - old_lambda_u), wide_abs(batch.lambda_V - old_lambda_v)));
+	residual = wide_max(residual, wide_abs(batch.lambda_Twist - old_lambda_twist));
+	residual = wide_max(residual, wide_max(wide_abs(delta_lambda_roll.x), wide_max(wide_abs(delta_lambda_roll.y), wide_abs(delta_lambda_roll.z))));
 
 
-				// Apply delta impulse
-				const glm::vec3 dir_impulse = delta_lambda * n;
-				pair->body_A->add_impulse(-dir_impulse, point.point_A);
-				pair->body_B->add_impulse(dir_impulse, point.point_B);
+	// Apply all the impulses
+	const wide_vec3 linear = normal_impulse * n + impulse_linear;
+	vA = vA - batch.invM_A * linear;
+	vB = vB + batch.invM_B * linear;
+	wA = wA - angular_A - batch.invI_A * (cross(batch.avg_R_A, impulse_linear) + impulse_angular);
+	wB = wB + angular_B + batch.invI_B * (cross(batch.avg_R_B, impulse_linear) + impulse_angular);
+	// Scatter, the first velocity is the shared static one and is never written
+	for (uint l = 0; l < c_simd_lanes; ++l)
+	{
+		if (batch.body_A[l])
+		{
+			bodies[batch.body_A[l]].linear_velocity = vA.get(l);
+			bodies[batch.body_A[l]].angular_velocity = wA.get(l);
+		}
+		if (batch.body_B[l])
+		{
+			bodies[batch.body_B[l]].linear_velocity = vB.get(l);
+			bodies[batch.body_B[l]].angular_velocity = wB.get(l);
+		}
+	}
+	return residual;
+}
+
+/**
+ * Solves the pairs packed in SIMD lanes. Pairs of a color are packed
+ * together so the lanes never share a dynamic body.
+**/
+void constraint_contact_solver::solve_wide(const std::vector<overlap_pair*>& overlaps, const std::vector<std::vector<uint>>& colors)
+{
+	// Pack each color in batches of lanes
+	std::vector<wide_contact_batch> batches;
+	std::vector<wide_contact_row> rows;
+	std::vector<uint> color_begin;
+	for (uint c = 0; c < colors.size(); ++c)
+	{
+		color_begin.push_back(static_cast<uint>(batches.size()));
+		// Pairs that did not fit any color go alone
+		const uint lanes = c == c_max_colors ? 1u : c_simd_lanes;
+		for (uint first = 0; first < colors[c].size(); first += lanes)
+		{
+			wide_contact_batch batch;
+			batch.row_begin = static_cast<uint>(rows.size());
+			for (uint l = 0; l < lanes && first + l < colors[c].size(); ++l)
+				batch.row_count = glm::max(batch.row_count, static_cast<uint>(overlaps[colors[c][first + l]]->manifold.points.size()));
+			rows.resize(rows.size() + batch.row_count);
+			// Fill the lanes
+			for (uint l = 0; l < lanes && first + l < colors[c].size(); ++l)
+			{
+				const uint index = colors[c][first + l];
+				overlap_pair* pair = overlaps[index];
+				const contact_manifold& manifold = pair->manifold;
+				batch.pairs[l] = pair;
+				batch.body_A[l] = m_pair_bodies[2u * index];
+				batch.body_B[l] = m_pair_bodies[2u * index + 1u];
+				batch.normal.set(l, manifold.normal);
+				batch.invM_A[l] = manifold.invM_A;
+				batch.invM_B[l] = manifold.invM_B;
+				batch.invI_A.set(l, manifold.invI_A);
+				batch.invI_B.set(l, manifold.invI_B);
+				// Normal constraints
+				for (uint p = 0; p < manifold.points.size(); ++p)
+				{
+					const contact_point& point = manifold.points[p];
+					wide_contact_row& row = rows[batch.row_begin + p];
+					const glm::vec3 rA_x_n = glm::cross(point.point_A - pair->body_A->m_position, manifold.normal);
+					const glm::vec3 rB_x_n = glm::cross(point.point_B - pair->body_B->m_position, manifold.normal);
+					row.rA_x_n.set(l, rA_x_n);
+					row.rB_x_n.set(l, rB_x_n);
+					row.invI_rA_x_n.set(l, manifold.invI_A * rA_x_n);
+					row.invI_rB_x_n.set(l, manifold.invI_B * rB_x_n);
+					row.inv_mass[l] = point.invM_Vel;
+					row.lambda[l] = point.lambda_Vel;
+					row.bias[l] = contact_bias(point);
+				}
+				// Friction constraints
+				batch.avg_R_A.set(l, manifold.avg_point_A - pair->body_A->m_position);
+				batch.avg_R_B.set(l, manifold.avg_point_B - pair->body_B->m_position);
+				batch.vec_U.set(l, manifold.vec_U);
+				batch.vec_V.set(l, manifold.vec_V);
+				batch.invM_U[l] = manifold.invM_U;
+				batch.invM_V[l] = manifold.invM_V;
+				batch.invM_Twist[l] = manifold.invM_Twist;
+				batch.invM_Roll.set(l, manifold.invM_Roll);
+				batch.coef_friction[l] = manifold.coef_friction;
+				batch.coef_roll[l] = manifold.coef_roll;
+				batch.lambda_U[l] = manifold.lambda_U;
+				batch.lambda_V[l] = manifold.lambda_V;
+				batch.lambda_Twist[l] = manifold.lambda_Twist;
+				batch.lambda_Roll.set(l, manifold.lambda_Roll);
 			}
+			batches.push_back(batch);
+		}
+	}
+	color_begin.push_back(static_cast<uint>(batches.size()));
 
 
-			// Compute velocities at friction points
-			glm::vec3 vfA = bA.get_velocity_at_point(manifold.avg_point_A);
-			glm::vec3 vfB = bB.get_velocity_at_point(manifold.avg_point_B);
-			// Compute angular velocities
-			glm::vec3 wA = bA.get_angular_velocity();
-			glm::vec3 wB = bB.get_angular_velocity();
-			// Compute maximum friction limit
-			const float max_friction_lambda = manifold.coef_friction * accum_lambda;
-			const float max_roll_lambda = manifold.coef_roll * accum_lambda;
-			
-			
-			// Compute Jv of the constraint
-			const float     Jv_u     = glm::dot(vfB - vfA, manifold.vec_U);
-			const float     Jv_v     = glm::dot(vfB - vfA, manifold.vec_V);
-			const float     Jv_twist = glm::dot(wB - wA, n);
-			const glm::vec3 Jv_roll  = wB - wA;
-			// Store previous state
-			const float     old_lambda_u     = manifold.lambda_U;
-			const float     old_lambda_v     = manifold.lambda_V;
-			const float     old_lambda_twist = manifold.lambda_Twist;
-			const glm::vec3 old_lambda_roll  = manifold.lambda_Roll;
-			// Compute lambda differential
-			float     delta_lambda_u     = manifold.invM_U     * -Jv_u;
-			float     delta_lambda_v     = manifold.invM_V     * -Jv_v;
-			float     delta_lambda_twist = manifold.invM_Twist * -Jv_twist;
-			glm::vec3 delta_lambda_roll  = manifold.invM_Roll  * -Jv_roll;
-			// Apply lambda differential
-			manifold.lambda_U     = glm::clamp(manifold.lambda_U     + delta_lambda_u,     -max_friction_lambda, max_friction_lambda);
-			manifold.lambda_V     = glm::clamp(manifold.lambda_V     + delta_lambda_v,     -max_friction_lambda, max_friction_lambda);
-			manifold.lambda_Twist = glm::clamp(manifold.lambda_Twist + delta_lambda_twist, -max_friction_lambda, max_friction_lambda);
-			manifold.lambda_Roll  = glm::clamp(manifold.lambda_Roll  + delta_lambda_roll,  -max_roll_lambda,     max_roll_lambda);
-			// Compute real lambda differential
-			delta_lambda_u     = manifold.lambda_U     - old_lambda_u;
-			delta_lambda_v     = manifold.lambda_V     - old_lambda_v;
-			delta_lambda_twist = manifold.lambda_Twist - old_lambda_twist;
-			delta_lambda_roll  = manifold.lambda_Roll  - old_lambda_roll;
-			
-			
-			// Compute friction impulses
-			const glm::vec3 impulse_linear
-				= delta_lambda_u * manifold.vec_U
-				+ delta_lambda_v * manifold.vec_V;
-			const glm::vec3 impulse_angular = delta_lambda_twist * n + delta_lambda_roll;
-			// Apply impulses
-			pair->body_A->add_impulse(-impulse_linear, manifold.avg_point_A);
-			pair->body_B->add_impulse(impulse_linear, manifold.avg_point_B);
-			pair->body_A->add_impulse_angular(-impulse_angular);
-			pair->body_B->add_impulse_angular(impulse_angular);
+	// For each iteration, until the lambdas stop changing
+	const bool parallel = m_pool && m_pool->get_thread_count() > 1u;
+	std::vector<wide_float> thread_residuals(parallel ? m_pool->get_thread_count() : 1u);
+	for (int it = 0; it < m_iteration_count; ++it)
+	{
+		for (wide_float& r : thread_residuals)
+			r = wide_float{};
+		for (uint c = 0; c < colors.size(); ++c)
+		{
+			const uint begin = color_begin[c];
+			const uint count = color_begin[c + 1u] - begin;
+			// Batches of a color share no body
+			if (parallel && c != c_max_colors)
+			{
+				m_pool->parallel_for(count, 4u, [&](uint b, uint e, uint thread)
+				{
+					for (uint i = begin + b; i < begin + e; ++i)
+						thread_residuals[thread] = wide_max(thread_residuals[thread], solve_wide_batch(batches[i], rows.data() + batches[i].row_begin, m_bodies));
+				});
+			}
+			else
+			{
+				for (uint i = begin; i < begin + count; ++i)
+					thread_residuals[0] = wide_max(thread_residuals[0], solve_wide_batch(batches[i], rows.data() + batches[i].row_begin, m_bodies));
+			}
 		}
+		// Reduce the lanes of every thread
+		float residual{ 0.0f };
+		for (const wide_float& r : thread_residuals)
+			for (uint l = 0; l < c_simd_lanes; ++l)
+				residual = glm::max(residual, r[l]);
+		m_residuals.push_back(residual);
+		if (residual < m_tolerance)
+			break;
+	}
+
+
+	// Store the lambdas for warm starting
+	for (const wide_contact_batch& batch : batches)
+	for (uint l = 0; l < c_simd_lanes; ++l)
+	{
+		if (!batch.pairs[l])
+			continue;
+		contact_manifold& manifold = batch.pairs[l]->manifold;
+		for (uint p = 0; p < manifold.points.size(); ++p)
+			manifold.points[p].lambda_Vel = rows[batch.row_begin + p].lambda[l];
+		manifold.lambda_U = batch.lambda_U[l];
+		manifold.lambda_V = batch.lambda_V[l];
+		manifold.lambda_Twist = batch.lambda_Twist[l];
+		manifold.lambda_Roll = batch.lambda_Roll.get(l);
 	}
 }
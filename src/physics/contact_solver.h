@@ -2,10 +2,85 @@
 #include "contact_info.h"
 #include <vector>
 
+class thread_pool;
+
+using uint = unsigned int;
+
+// Velocities of a body while the contacts are solved
+struct solver_body
+{
+	glm::vec3 position;
+	glm::vec3 linear_velocity;
+	glm::vec3 angular_velocity;
+	glm::mat3 inv_inertia;
+	float     inv_mass;
+
+	void add_impulse(const glm::vec3& impulse, const glm::vec3& point);
+	void add_impulse_angular(const glm::vec3& impulse);
+};
+
+// Velocities only used to push bodies out of penetration, they are
+// applied to the positions and then dropped so they add no energy
+struct pseudo_velocity
+{
+	glm::vec3 linear;
+	glm::vec3 angular;
+};
+
 struct constraint_contact_solver
 {
+	static const unsigned c_max_colors{ 64u };
+	static const unsigned c_max_block_points{ 4u };
+	static constexpr float c_block_regularization{ 1e-3f };
+
 	const int m_iteration_count{ 1 };
 	const float m_baumgarte{ 0.0f };
 	const bool m_warm_start{ false };
+	thread_pool* m_pool{ nullptr };
+	// Solve packed in SIMD lanes, the block solver takes priority over it
+	const bool m_wide{ false };
+	const bool m_block{ false };
+	// Iterations of the split impulse position pass, Baumgarte velocity bias when zero
+	const int m_position_iteration_count{ 0 };
+	// Relax pass: continues from the impulses already applied this step
+	// without warm starting, and without the penetration bias
+	const bool m_relax{ false };
+	// Iterations stop once no lambda changes more than this, m_iteration_count is the cap
+	const float m_tolerance{ 0.0f };
+	// Up direction of the shock propagation pass, no pass when zero
+	const glm::vec3 m_shock_up{ 0.0f };
+	// Jacobi with mass splitting: every pair solves its own copy of the bodies
+	// in parallel without coloring, the copies are averaged after each iteration
+	const bool m_mass_splitting{ false };
+	// Duration of the step being solved
+	const float m_dt{ physics_dt };
+	// Bodies of the contacts, static bodies share the first one
+	std::vector<body*> m_owners{};
+	std::vector<solver_body> m_bodies{};
+	// Solver body of A and B for each pair
+	std::vector<uint> m_pair_bodies{};
+	// Normal effective mass matrix of each pair for the block solver
+	std::vector<glm::mat4> m_block_mass{};
+	// Position correction of each body for the split impulse pass
+	std::vector<pseudo_velocity> m_pseudo_velocities{};
+	// Biggest lambda change of each velocity iteration run
+	std::vector<float> m_residuals{};
 	void evaluate(std::vector<overlap_pair*>& overlaps);
+
+private:
+	void build_bodies(const std::vector<overlap_pair*>& overlaps);
+	void store_bodies()const;
+	void color_overlaps(const std::vector<overlap_pair*>& overlaps, std::vector<std::vector<uint>>& colors)const;
+	void build_block_mass(const std::vector<overlap_pair*>& overlaps);
+	void build_pair_block_mass(const overlap_pair& pair, uint index);
+	float contact_bias(const contact_point& point)const;
+	float solve_pair(overlap_pair& pair, uint index);
+	bool solve_block(overlap_pair& pair, uint index, float& residual);
+	float sweep(const std::vector<overlap_pair*>& overlaps, const std::vector<std::vector<uint>>& colors, float (constraint_contact_solver::*solve)(overlap_pair&, uint));
+	void solve_wide(const std::vector<overlap_pair*>& overlaps, const std::vector<std::vector<uint>>& colors);
+	float solve_pair_position(overlap_pair& pair, uint index);
+	void shock_propagation(const std::vector<overlap_pair*>& overlaps);
+	void solve_split(const std::vector<overlap_pair*>& overlaps);
+	void set_split_masses(const std::vector<overlap_pair*>& overlaps, uint begin, uint end);
+
 };
\ No newline at end of file
@@ -0,0 +1,179 @@
+/**
+ * @file heightfield.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Regular grid of quantized heights for large static terrain
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "heightfield.h"
+#include "math_utils.h"
+#include <algorithm>
+
+/**
+ * Quantize the heights to 16 bits over their own range
+**/
+void heightfield::set_heights(uint size_x, uint size_z, float cell_size, const std::vector<float>& heights)
+{
+	assert(size_x >= 2u && size_z >= 2u);
+	assert(heights.size() == size_x * size_z);
+	m_size_x = size_x;
+	m_size_z = size_z;
+	m_cell_size = cell_size;
+	// Compute height range
+	const auto range = std::minmax_element(heights.begin(), heights.end());
+	m_min_height = *range.first;
+	m_height_step = (*range.second - *range.first) / 65535.0f;
+	// Quantize
+	m_heights.resize(heights.size());
+	for (uint i = 0; i < heights.size(); ++i)
+		m_heights[i] = m_height_step > 0.0f
+			? static_cast<uint16_t>(glm::round((heights[i] - m_min_height) / m_height_step))
+			: 0u;
+	// Compute bounds
+	m_bounds = { glm::vec3{ 0.0f, m_min_height, 0.0f },
+		glm::vec3{ (size_x - 1) * cell_size, *range.second, (size_z - 1) * cell_size } };
+}
+float heightfield::get_height(uint x, uint z) const
+{
+	return m_min_height + m_height_step * m_heights[z * m_size_x + x];
+}
+glm::vec3 heightfield::get_vertex(uint x, uint z) const
+{
+	return { x * m_cell_size, get_height(x, z), z * m_cell_size };
+}
+/**
+ * Collect the triangles of the cells under the box, rejecting
+ * cells whose height range does not reach it
+**/
+void heightfield::query(const aabb & box, std::vector<uint>& out) const
+{
+	if (!box.overlaps(m_bounds))
+		return;
+	// Compute covered cell range
+	const float inv_cell = 1.0f / m_cell_size;
+	const uint x0 = static_cast<uint>(glm::max(box.m_min.x * inv_cell, 0.0f));
+	const uint z0 = static_cast<uint>(glm::max(box.m_min.z * inv_cell, 0.0f));
+	const uint x1 = glm::min(static_cast<uint>(glm::max(box.m_max.x * inv_cell, 0.0f)), m_size_x - 2u);
+	const uint z1 = glm::min(static_cast<uint>(glm::max(box.m_max.z * inv_cell, 0.0f)), m_size_z - 2u);
+	for (uint z = z0; z <= z1; ++z)
+		for (uint x = x0; x <= x1; ++x)
+		{
+			// Check cell height range
+			const float h0 = get_height(x, z);
+			const float h1 = get_height(x + 1, z);
+			const float h2 = get_height(x, z + 1);
+			const float h3 = get_height(x + 1, z + 1);
+			if (glm::max(glm::max(h0, h1), glm::max(h2, h3)) < box.m_min.y
+			||  glm::min(glm::min(h0, h1), glm::min(h2, h3)) > box.m_max.y)
+				continue;
+			const uint cell = z * (m_size_x - 1u) + x;
+			out.push_back(cell * 2u);
+			out.push_back(cell * 2u + 1u);
+		}
+}
+void heightfield::get_triangle(uint idx, glm::vec3(&tri)[3]) const
+{
+	const uint cell = idx / 2u;
+	const uint x = cell % (m_size_x - 1u);
+	const uint z = cell / (m_size_x - 1u);
+	const glm::vec3 a = get_vertex(x, z);
+	const glm::vec3 c = get_vertex(x + 1, z + 1);
+	// Both triangles are wound to face up
+	tri[0] = a;
+	tri[1] = (idx % 2u == 0u) ? get_vertex(x, z + 1) : c;
+	tri[2] = (idx % 2u == 0u) ? c : get_vertex(x + 1, z);
+}
+/**
+ * Perform ray intersection walking the cells under the ray
+**/
+ray_info heightfield::ray_cast(const ray & local_ray) const
+{
+	ray_info info;
+	if (m_heights.empty())
+		return info;
+	// Clip the ray against the bounds
+	float t_enter{ 0.0f };
+	float t_exit{ FLT_MAX };
+	for (int i = 0; i < 3; ++i)
+	{
+		if (std::abs(local_ray.m_direction[i]) < c_epsilon)
+		{
+			if (local_ray.m_start[i] < m_bounds.m_min[i] || local_ray.m_start[i] > m_bounds.m_max[i])
+				return info;
+			continue;
+		}
+		float t0 = (m_bounds.m_min[i] - local_ray.m_start[i]) / local_ray.m_direction[i];
+		float t1 = (m_bounds.m_max[i] - local_ray.m_start[i]) / local_ray.m_direction[i];
+		if (t0 > t1)
+			std::swap(t0, t1);
+		t_enter = glm::max(t_enter, t0);
+		t_exit = glm::min(t_exit, t1);
+		if (t_enter > t_exit)
+			return info;
+	}
+	// Find the entering cell
+	const glm::vec3 p = local_ray.get_point(t_enter);
+	int x = glm::clamp(static_cast<int>(p.x / m_cell_size), 0, static_cast<int>(m_size_x) - 2);
+	int z = glm::clamp(static_cast<int>(p.z / m_cell_size), 0, static_cast<int>(m_size_z) - 2);
+	// Setup the grid walk
+	const glm::vec3& d = local_ray.m_direction;
+	const int step_x = d.x > 0.0f ? 1 : -1;
+	const int step_z = d.z > 0.0f ? 1 : -1;
+	const float delta_x = std::abs(d.x) > c_epsilon ? m_cell_size / std::abs(d.x) : FLT_MAX;
+	const float delta_z = std::abs(d.z) > c_epsilon ? m_cell_size / std::abs(d.z) : FLT_MAX;
+	float next_x = std::abs(d.x) > c_epsilon ? ((x + (step_x > 0 ? 1 : 0)) * m_cell_size - local_ray.m_start.x) / d.x : FLT_MAX;
+	float next_z = std::abs(d.z) > c_epsilon ? ((z + (step_z > 0 ? 1 : 0)) * m_cell_size - local_ray.m_start.z) / d.z : FLT_MAX;
+	// Walk until the first cell hit, which is the closest one
+	while (true)
+	{
+		if (ray_cast_cell(local_ray, x, z, info))
+			return info;
+		if (glm::min(next_x, next_z) > t_exit)
+			return info;
+		if (next_x < next_z)
+			x += step_x, next_x += delta_x;
+		else
+			z += step_z, next_z += delta_z;
+		if (x < 0 || z < 0 || x > static_cast<int>(m_size_x) - 2 || z > static_cast<int>(m_size_z) - 2)
+			return info;
+	}
+}
+bool heightfield::ray_cast_cell(const ray & local_ray, uint x, uint z, ray_info & info) const
+{
+	const uint cell = z * (m_size_x - 1u) + x;
+	for (uint k = 0; k < 2u; ++k)
+	{
+		glm::vec3 tri[3];
+		get_triangle(cell * 2u + k, tri);
+		const float time = ray_cast_triangle(local_ray, tri[0], tri[1], tri[2]);
+		if (time >= 0.0f && time < info.m_time)
+		{
+			info.m_intersected = true;
+			info.m_time = time;
+			info.m_normal = glm::normalize(glm::cross(tri[1] - tri[0], tri[2] - tri[0]));
+		}
+	}
+	return info.m_intersected;
+}
+/**
+ * Extract the triangles of the terrain
+**/
+std::pair<std::vector<glm::vec3>, std::vector<glm::vec3>> heightfield::get_triangles() const
+{
+	std::vector<glm::vec3> tri;
+	std::vector<glm::vec3> norm;
+	if (m_heights.empty())
+		return { tri,norm };
+	const uint count = (m_size_x - 1u) * (m_size_z - 1u) * 2u;
+	tri.reserve(count * 3u);
+	norm.reserve(count * 3u);
+	for (uint i = 0; i < count; ++i)
+	{
+		glm::vec3 t[3];
+		get_triangle(i, t);
+		const glm::vec3 n = glm::normalize(glm::cross(t[1] - t[0], t[2] - t[0]));
+		for (int j = 0; j < 3; ++j)
+			tri.push_back(t[j]), norm.push_back(n);
+	}
+	return { tri,norm };
+}
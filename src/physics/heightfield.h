@@ -0,0 +1,39 @@
+/**
+ * @file heightfield.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Regular grid of quantized heights for large static terrain
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include "physical_mesh.h"
+#include "aabb.h"
+#include <vector>
+#include <cstdint>
+
+/**
+ * Samples live on the XZ plane of the local space, starting at the origin.
+ * Each cell is split in two triangles, indexed as cell * 2 + {0, 1}.
+**/
+struct heightfield
+{
+	uint m_size_x{ 0u };
+	uint m_size_z{ 0u };
+	float m_cell_size{ 1.0f };
+	float m_min_height{ 0.0f };
+	float m_height_step{ 0.0f };
+	std::vector<uint16_t> m_heights;
+	aabb m_bounds;
+
+	void set_heights(uint size_x, uint size_z, float cell_size, const std::vector<float>& heights);
+	float get_height(uint x, uint z)const;
+	glm::vec3 get_vertex(uint x, uint z)const;
+	void query(const aabb& box, std::vector<uint>& out)const;
+	void get_triangle(uint idx, glm::vec3 (&tri)[3])const;
+	ray_info ray_cast(const ray& local_ray)const;
+	std::pair<std::vector<glm::vec3>,
+		std::vector<glm::vec3> > get_triangles()const;
+
+private:
+	bool ray_cast_cell(const ray& local_ray, uint x, uint z, ray_info& info)const;
+};
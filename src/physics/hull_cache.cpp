@@ -0,0 +1,56 @@
+/**
+ * @file hull_cache.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief World space data of a convex hull, computed once per step
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "hull_cache.h"
+#include "physical_mesh.h"
+#include "body.h"
+#include "math_utils.h"
+
+/**
+ * Transforms the face planes and edges of the hull into world space,
+ * so every pair touching the body reuses them
+**/
+void hull_cache::build(const physical_mesh & mesh, const body & b)
+{
+	// Rigid transformation, inverse is the transposed rotation
+	const glm::mat3 rot = b.get_basis();
+	m_position = b.m_position;
+	m_inv_rotation = glm::transpose(rot);
+	m_transform = b.get_model();
+	m_inv_transform = glm::mat4(m_inv_rotation);
+	m_inv_transform[3] = glm::vec4(-(m_inv_rotation * m_position), 1.0f);
+
+	// Face planes, in the same order as the faces of the mesh
+	m_planes.clear();
+	m_planes.reserve(mesh.m_faces.size());
+	for (const auto& f : mesh.m_faces)
+	{
+		const glm::vec3 normal = rot * glm::vec3(f.m_plane);
+		m_planes.push_back(glm::vec4(normal, f.m_plane.w + glm::dot(normal, m_position)));
+	}
+
+	// Edges, only one of each pair of twins
+	m_edges.clear();
+	for (const auto& e : mesh.m_hedges)
+	{
+		if (e.m_twin < &e)
+			continue;
+		m_edges.push_back({
+			tr_point(m_transform, mesh.m_vertices[e.get_start()]),
+			tr_point(m_transform, mesh.m_vertices[e.get_end()]),
+			rot * glm::vec3(e.m_face->m_plane),
+			rot * glm::vec3(e.m_twin->m_face->m_plane),
+			&e });
+	}
+}
+/**
+ * Rotates a world direction into space of the hull
+**/
+glm::vec3 hull_cache::to_local(const glm::vec3 & dir) const
+{
+	return m_inv_rotation * dir;
+}
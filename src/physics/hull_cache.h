@@ -0,0 +1,36 @@
+/**
+ * @file hull_cache.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief World space data of a convex hull, computed once per step
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+struct physical_mesh;
+struct body;
+struct half_edge;
+
+struct hull_cache
+{
+	struct edge
+	{
+		glm::vec3 m_start;
+		glm::vec3 m_end;
+		glm::vec3 m_normal;
+		glm::vec3 m_twin_normal;
+		const half_edge* m_hedge;
+	};
+
+	glm::mat4 m_transform;
+	glm::mat4 m_inv_transform;
+	glm::mat3 m_inv_rotation;
+	glm::vec3 m_position;
+	std::vector<glm::vec4> m_planes;
+	std::vector<edge> m_edges;
+
+	void build(const physical_mesh& mesh, const body& b);
+	glm::vec3 to_local(const glm::vec3& dir)const;
+};
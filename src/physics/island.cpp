@@ -0,0 +1,56 @@
+/**
+ * @file island.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Groups of bodies connected through contacts
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "island.h"
+
+/**
+ * Every body starts as its own island
+**/
+void island_graph::reset(uint count)
+{
+	m_parent.resize(count);
+	for (uint i = 0; i < count; ++i)
+		m_parent[i] = i;
+}
+/**
+ * Finds the root of the island, flattening the path on the way
+**/
+uint island_graph::find(uint idx)
+{
+	while (m_parent[idx] != idx)
+	{
+		m_parent[idx] = m_parent[m_parent[idx]];
+		idx = m_parent[idx];
+	}
+	return idx;
+}
+/**
+ * Joins the islands of both bodies
+**/
+void island_graph::merge(uint a, uint b)
+{
+	a = find(a);
+	b = find(b);
+	// Keep the lowest index as root so the result does not depend on the order
+	if (a < b)
+		m_parent[b] = a;
+	else if (b < a)
+		m_parent[a] = b;
+}
+/**
+ * Wakes the sleeping bodies of the islands with any awake body, keeping their sleep time
+**/
+void island_graph::wake_islands(std::vector<body>& bodies)
+{
+	std::vector<bool> awake(bodies.size(), false);
+	for (uint i = 0; i < bodies.size(); ++i)
+		if (!bodies[i].m_is_static && !bodies[i].m_is_sleeping)
+			awake[find(i)] = true;
+	for (uint i = 0; i < bodies.size(); ++i)
+		if (awake[find(i)])
+			bodies[i].m_is_sleeping = false;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file island.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Groups of bodies connected through contacts
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include "body.h"
+#include <vector>
+
+using uint = unsigned int;
+
+class island_graph
+{
+	std::vector<uint> m_parent;
+
+public:
+	void reset(uint count);
+	uint find(uint idx);
+	void merge(uint a, uint b);
+	void wake_islands(std::vector<body>& bodies);
+};
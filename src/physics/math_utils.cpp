@@ -1,4 +1,5 @@
 #include "math_utils.h"
+#include "ray.h"
 
 glm::vec3 tr_point(glm::mat4 m, glm::vec3 v)
 {
@@ -168,6 +169,29 @@ glm::vec3 make_ortho(const glm::vec3 n)
 	return{};
 }
 
+float ray_cast_triangle(const ray & r, const glm::vec3 & a, const glm::vec3 & b, const glm::vec3 & c)
+{
+	const glm::vec3 e1 = b - a;
+	const glm::vec3 e2 = c - a;
+	const glm::vec3 p = glm::cross(r.m_direction, e2);
+	const float det = glm::dot(e1, p);
+	if (std::abs(det) < c_epsilon)
+		return -1.0f;
+
+	const float inv_det = 1.0f / det;
+	const glm::vec3 s = r.m_start - a;
+	const float u = glm::dot(s, p) * inv_det;
+	if (u < 0.0f || u > 1.0f)
+		return -1.0f;
+
+	const glm::vec3 q = glm::cross(s, e1);
+	const float v = glm::dot(r.m_direction, q) * inv_det;
+	if (v < 0.0f || u + v > 1.0f)
+		return -1.0f;
+
+	return glm::dot(e2, q) * inv_det;
+}
+
 float rand01()
 {
 	return rand() / (float)RAND_MAX;
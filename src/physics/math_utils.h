@@ -3,9 +3,16 @@
 #include <utility>
 #include <vector>
 
+struct ray;
+
 const float c_epsilon{ 1e-5f };
 const float c_rest_vel_threshold{ 1.0f };
 const float c_depth_threshold{ 0.01f };
+const float c_reuse_distance{ 0.005f };
+const float c_reuse_rotation{ 0.99999f };
+const float c_sleep_linear_velocity{ 0.05f };
+const float c_sleep_angular_velocity{ 0.05f };
+const float c_time_to_sleep{ 0.5f };
 
 glm::vec3 tr_point(glm::mat4 m, glm::vec3 v);
 glm::vec3 tr_vector(glm::mat4 m, glm::vec3 v);
@@ -19,5 +26,7 @@ glm::vec3 project_point_plane(const glm::vec3& point, const glm::vec3& normal, c
 
 glm::vec3 make_ortho(const glm::vec3 n);
 
+float ray_cast_triangle(const ray& r, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+
 float rand01();
 float rand(float a, float b);
\ No newline at end of file
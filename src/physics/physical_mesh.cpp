@@ -20,6 +20,18 @@ physical_mesh::physical_mesh(physical_mesh && o)
 	for (auto&f : m_faces)
 		f.m_owner = this;
 }
+/**
+ * Move assignment, so removed bodies can be replaced in the vector of meshes
+**/
+physical_mesh & physical_mesh::operator=(physical_mesh && o)
+{
+	m_vertices = std::move(o.m_vertices);
+	m_hedges = std::move(o.m_hedges);
+	m_faces = std::move(o.m_faces);
+	for (auto&f : m_faces)
+		f.m_owner = this;
+	return *this;
+}
 
 /**
  * Add a new face to the mesh
@@ -352,6 +364,31 @@ ray_info physical_mesh::ray_cast(const ray & local_ray)const
 	return support_point_hillclimb(dir);
  }
 /**
+* Computes the tight box of the transformed mesh using support points
+**/
+aabb physical_mesh::get_aabb(const glm::mat4& tr) const
+{
+	aabb box;
+	const glm::mat3 inv_basis = glm::transpose(glm::mat3(tr));
+	for (int i = 0; i < 3; ++i)
+	{
+		const glm::vec3 dir = inv_basis[i];
+		box.m_max[i] = tr_point(tr, support(dir))[i];
+		box.m_min[i] = tr_point(tr, support(-dir))[i];
+	}
+	return box;
+}
+/**
+* Computes the distance of the furthest vertex to the origin
+**/
+float physical_mesh::get_radius() const
+{
+	float r2{ 0.0f };
+	for (const auto& v : m_vertices)
+		r2 = glm::max(r2, glm::length2(v));
+	return glm::sqrt(r2);
+}
+/**
 * Computes the support point using a bruteforce approach
 **/
 glm::vec3 physical_mesh::support_point_bruteforce(glm::vec3 dir)const
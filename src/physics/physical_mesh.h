@@ -9,6 +9,7 @@
 #include "face.h"
 #include "half_edge.h"
 #include "ray.h"
+#include "aabb.h"
 #include <vector>
 #include <list>
 
@@ -23,6 +24,7 @@ struct physical_mesh
 {
 	physical_mesh() = default;
 	physical_mesh(physical_mesh&&);
+	physical_mesh& operator=(physical_mesh&&);
 
 	std::vector<glm::vec3> m_vertices;
 	std::list<half_edge> m_hedges;
@@ -41,6 +43,8 @@ struct physical_mesh
 	bool is_coplanar(const half_edge* hedge)const;
 	ray_info ray_cast(const ray& local_ray)const;
 	glm::vec3 support(glm::vec3 dir)const;
+	aabb get_aabb(const glm::mat4& tr)const;
+	float get_radius()const;
 	glm::vec3 support_point_bruteforce(glm::vec3 dir)const;
 	glm::vec3 support_point_hillclimb(glm::vec3 dir, const half_edge* start = nullptr)const;
 	const face* find_most_antiparallel_face(const glm::vec3& dir)const;
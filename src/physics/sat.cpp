@@ -12,15 +12,35 @@
 #include "math_utils.h"
 #include <glm/glm.hpp>
 
-sat::sat(const overlap_pair * pair)
+/**
+ * Axes separating by less than the margin still generate
+ * contacts, with negative depth (speculative contacts).
+ * World space hull data is shared by every pair of a body
+ * when given, otherwise it is computed here.
+**/
+sat::sat(const overlap_pair * pair, float margin, const hull_cache* cache_A, const hull_cache* cache_B)
 :   bA(pair->body_A), bB(pair->body_B),
 	mA(pair->mesh_A), mB(pair->mesh_B),
-	trAtoWorld(bA->get_model()), trBtoWorld(bB->get_model()),
-	trAtoB(bB->get_invmodel() * bA->get_model()),
-	trBtoA(glm::inverse(trAtoB)),
+	cA(cache_A), cB(cache_B),
 	was_colliding{pair->m_state == overlap_pair::state::Collision},
+	margin{ margin },
 	prev_data{ pair->prev_data }, next_data{ pair->prev_data }
-{}
+{
+	// Build missing caches
+	if (!cA)
+	{
+		own_cache_A.build(*mA, *bA);
+		cA = &own_cache_A;
+	}
+	if (!cB)
+	{
+		own_cache_B.build(*mB, *bB);
+		cB = &own_cache_B;
+	}
+	// Relative transformations, used for the manifold
+	trAtoB = cB->m_inv_transform * cA->m_transform;
+	trBtoA = cA->m_inv_transform * cB->m_transform;
+}
 
 sat::result sat::test_collision()
 {
@@ -32,10 +52,10 @@ sat::result sat::test_collision()
 		switch (prev_data.m_actor)
 		{
 		case sat::actor::A:
-			penetration = compute_face_penetration(mB, trAtoB, prev_data.m_face);
+			penetration = compute_face_penetration(mB, cB, cA->m_planes[prev_data.m_face_index]);
 			break;
 		case sat::actor::B:
-			penetration = compute_face_penetration(mA, trBtoA, prev_data.m_face);
+			penetration = compute_face_penetration(mA, cA, cB->m_planes[prev_data.m_face_index]);
 			break;
 		case sat::actor::Edge:
 			{
@@ -71,9 +91,9 @@ sat::result sat::test_collision()
 		if (valid_penetration)
 		{
 			// Check if there are still separating
-			if (!was_colliding && penetration <= 0.0f)
+			if (!was_colliding && penetration <= -margin)
 				return{};
-			if (was_colliding && penetration > 0.0f)
+			if (was_colliding && penetration > -margin)
 			{
 				next_data.m_penetration = penetration;
 				return generate_manifold(next_data);
@@ -83,7 +103,7 @@ sat::result sat::test_collision()
 	// Compute face normals of A as separating axis
 	penetration_data face_A_pen = test_faces(actor::A);
 	// Check if negative penetration -> separating axis
-	if (face_A_pen.m_penetration <= c_epsilon)
+	if (face_A_pen.m_penetration <= c_epsilon - margin)
 	{
 		next_data = face_A_pen;
 		return {};
@@ -91,7 +111,7 @@ sat::result sat::test_collision()
 	// Check face normals of B as separating axis
 	penetration_data face_B_pen = test_faces(actor::B);
 	// Check if negative penetration -> separating axis
-	if (face_B_pen.m_penetration <= c_epsilon)
+	if (face_B_pen.m_penetration <= c_epsilon - margin)
 	{
 		next_data = face_B_pen;
 		return {};
@@ -99,7 +119,7 @@ sat::result sat::test_collision()
 	// Check edge vs edge
 	penetration_data edge_pen = test_edges();
 	// Check if negative penetration -> separating axis
-	if (edge_pen.m_penetration <= c_epsilon)
+	if (edge_pen.m_penetration <= c_epsilon - margin)
 	{
 		next_data = edge_pen;
 		return {};
@@ -129,106 +149,88 @@ sat::penetration_data sat::test_faces(actor a)
 	bool actor_is_A{ a == actor::A };
 	const physical_mesh* mCur{ actor_is_A ? mA : mB };
 	const physical_mesh* mOther{ actor_is_A ? mB : mA };
-	const glm::mat4& trCurToOther{ actor_is_A ? trAtoB : trBtoA };
+	const hull_cache* cCur{ actor_is_A ? cA : cB };
+	const hull_cache* cOther{ actor_is_A ? cB : cA };
 	// Minimum penetration info
 	penetration_data min_penetration{a};
 	// For each face in acting mesh
-	for (auto it = mCur->m_faces.cbegin(); it != mCur->m_faces.cend(); ++it)
+	unsigned idx{ 0u };
+	for (auto it = mCur->m_faces.cbegin(); it != mCur->m_faces.cend(); ++it, ++idx)
 	{
 		// Get current face
 		const face* f = &*it;
 		// Compute face penetration
-		const float penetration = compute_face_penetration(mOther, trCurToOther, f);
-		// If penetration is negative -> Found a separating axis
-		if (penetration < 0.0f)
+		const float penetration = compute_face_penetration(mOther, cOther, cCur->m_planes[idx]);
+		// If penetration is below the margin -> Found a separating axis
+		if (penetration < -margin)
 		{
 			penetration_data face_pen{ a,penetration };
 			face_pen.m_face = f;
+			face_pen.m_face_index = idx;
 			return face_pen;
 		}
 		// Store minimum penetration
 		if (penetration < min_penetration.m_penetration)
 		{
 			min_penetration.m_face = f;
+			min_penetration.m_face_index = idx;
 			min_penetration.m_penetration = penetration;
 		}
 	}
 	// Return minimum penetration
 	return min_penetration;
 }
-float sat::compute_face_penetration(const physical_mesh * other, const glm::mat4 tr, const face * face)
+float sat::compute_face_penetration(const physical_mesh * other, const hull_cache * other_cache, const glm::vec4& plane)
 {
-	// Get face data
-	const glm::vec4& planeA = face->m_plane;
-	const glm::vec3 normalA = glm::vec3(planeA);
-	const glm::vec3 pointA = normalA * planeA.w;
-	// Transform to B space
-	const glm::vec3 normalB = tr_vector(tr, normalA);
-	const glm::vec3 pointB = tr_point(tr, pointA);
-	// Get support point
-	const glm::vec3 supp = other->support(-normalB);
+	// Get world face data
+	const glm::vec3 normal = glm::vec3(plane);
+	// Get support point in space of other
+	const glm::vec3 local_normal = other_cache->to_local(normal);
+	const glm::vec3 supp = other->support(-local_normal);
 	// Compute penetration
-	return glm::dot(pointB - supp, normalB);
+	return plane.w - glm::dot(local_normal, supp) - glm::dot(normal, other_cache->m_position);
 }
 sat::penetration_data sat::test_edges()
 {
 	// Minimum penetration info
 	penetration_data min_penetration{ actor::Edge };
-	// For each face in mesh A
-	for (auto itA = mA->m_hedges.cbegin(); itA != mA->m_hedges.cend(); ++itA)
+	// Centroid of A
+	const glm::vec3& centroidA = cA->m_position;
+	// For each edge in mesh A
+	for (const auto& edge1 : cA->m_edges)
 	{
-		// Get current edge 1
-		const half_edge* edge1{ &*itA };
-		// Avoid second computation for twin
-		if (edge1->m_twin < edge1)
-			continue;
 		// Get edge 1 data
-		const glm::vec3 edge1_start = tr_point(trAtoB, mA->m_vertices[edge1->get_start()]);
-		const glm::vec3 edge1_end = tr_point(trAtoB, mA->m_vertices[edge1->get_end()]);
-		const glm::vec3 edge1_dir = edge1_end - edge1_start;
-		const glm::vec3 edge1_normal = tr_vector(trAtoB, edge1->m_face->m_plane);
-		const glm::vec3 edge1_twinnormal = tr_vector(trAtoB, edge1->m_twin->m_face->m_plane);
-		// For each face in mesh B
-		for (auto itB = mB->m_hedges.cbegin(); itB != mB->m_hedges.cend(); ++itB)
+		const glm::vec3 edge1_dir = edge1.m_end - edge1.m_start;
+		// For each edge in mesh B
+		for (const auto& edge2 : cB->m_edges)
 		{
-			// Get current edge 2
-			const half_edge* edge2{ &*itB };
-			// Avoid second computation for twin
-			if (edge2->m_twin < edge2)
-				continue;
 			// Get edge 2 data
-			const glm::vec3 edge2_start = mB->m_vertices[edge2->get_start()];
-			const glm::vec3 edge2_end = mB->m_vertices[edge2->get_end()];
-			const glm::vec3 edge2_dir = edge2_end - edge2_start;
-			const glm::vec3 edge2_normal = edge2->m_face->m_plane;
-			const glm::vec3 edge2_twinnormal = edge2->m_twin->m_face->m_plane;
+			const glm::vec3 edge2_dir = edge2.m_end - edge2.m_start;
 			// Check if the two edges build a minkowski face
-			if (test_gaussmap_intersect(edge1_normal, edge1_twinnormal, -edge2_normal, -edge2_twinnormal, -edge1_dir, -edge2_dir))
+			if (test_gaussmap_intersect(edge1.m_normal, edge1.m_twin_normal, -edge2.m_normal, -edge2.m_twin_normal, -edge1_dir, -edge2_dir))
 			{
-				// Compute centroide of A in space of B 
-				const glm::vec3 centroidA = tr_point(trAtoB, glm::vec3{ 0.0f });
 				// Compute edge penetration
-				const float penetration = compute_edge_penetration(edge1_start, edge2_start, centroidA, edge1_dir, edge2_dir);
-				// If penetration is negative -> Found a separating axis
-				if (penetration < 0.0f)
+				const float penetration = compute_edge_penetration(edge1.m_start, edge2.m_start, centroidA, edge1_dir, edge2_dir);
+				// If penetration is below the margin -> Found a separating axis
+				if (penetration < -margin)
 				{
 					penetration_data edge_pen{ actor::Edge, penetration };
-					edge_pen.m_edgeA = edge1;	
-					edge_pen.m_edgeB = edge2;
+					edge_pen.m_edgeA = edge1.m_hedge;
+					edge_pen.m_edgeB = edge2.m_hedge;
 					return edge_pen;
 				}
 				// Store minimum penetration
 				if (penetration < min_penetration.m_penetration)
 				{
-					min_penetration.m_edgeA = edge1;
-					min_penetration.m_edgeB = edge2;
+					min_penetration.m_edgeA = edge1.m_hedge;
+					min_penetration.m_edgeB = edge2.m_hedge;
 					min_penetration.m_penetration = penetration;
 					// Store edge data to avoid
 					// unnecesary recomputations
-					edge_data[0] = edge1_start;
-					edge_data[1] = edge1_end;
-					edge_data[2] = edge2_start;
-					edge_data[3] = edge2_end;
+					edge_data[0] = edge1.m_start;
+					edge_data[1] = edge1.m_end;
+					edge_data[2] = edge2.m_start;
+					edge_data[3] = edge2.m_end;
 				}
 			}
 		}
@@ -280,19 +282,14 @@ sat::result sat::generate_manifold(const penetration_data & data)
 		const auto closest = closest_point_segments(edge1_start, edge1_end, edge2_start, edge2_end);
 		const glm::vec3& edge1_closest = closest.first;
 		const glm::vec3& edge2_closest = closest.second;
-		// Get closest in local A
-		const glm::vec3 edge1_closestlocal = tr_point(trBtoA, edge1_closest);
-		// Compute normal in A
-		const glm::vec3 normalA = edge1_closestlocal;
-		assert(glm::length2(normalA) > 0.0f);
-		// Compute normal in world
-		const glm::vec3 normalW = glm::normalize(tr_vector(trAtoWorld, normalA));
+		// Compute normal in world, from centroid of A
+		const glm::vec3 normalW = glm::normalize(edge1_closest - cA->m_position);
 		assert(glm::length2(normalW) > 0.0f);
 		// Create contact manifold
 		simple_manifold manifold;
 		manifold.m_normal = normalW;
-		manifold.m_local_A = { edge1_closestlocal };
-		manifold.m_local_B = { edge2_closest };
+		manifold.m_local_A = { tr_point(cA->m_inv_transform, edge1_closest) };
+		manifold.m_local_B = { tr_point(cB->m_inv_transform, edge2_closest) };
 		return {true, manifold };
 	}
 	// If the axis is a face normal
@@ -309,7 +306,7 @@ sat::result sat::generate_manifold(const penetration_data & data)
 		const glm::vec3 axisRef = faceRef->m_plane;
 		const glm::vec3 axisInc = tr_vector(trRefToInc, axisRef);
 		// Compute normal in world
-		const glm::vec3 normalW = actor_is_A ? tr_vector(trAtoWorld, axisRef) : -tr_vector(trBtoWorld, axisRef);
+		const glm::vec3 normalW = actor_is_A ? glm::vec3(cA->m_planes[data.m_face_index]) : -glm::vec3(cB->m_planes[data.m_face_index]);
 		// Find most antiparrallel face
 		const face* faceInc = mInc->find_most_antiparallel_face(axisInc);
 		// Fill face vertices in Reference space
@@ -346,8 +343,8 @@ sat::result sat::generate_manifold(const penetration_data & data)
 		{
 			// Compute vertex penetration
 			const float penetration = glm::dot(vtxRef - v, axisRef);
-			// If penetration is positive -> push point as contact
-			if (penetration >= 0.0f)
+			// If penetration is within the margin -> push point as contact
+			if (penetration >= -margin)
 			{
 				// Compute local_A & local_B
 				const glm::vec3 pointInc = tr_point(trRefToInc, v);
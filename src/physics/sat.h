@@ -6,6 +6,7 @@
  * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
 **/
 #pragma once
+#include "hull_cache.h"
 #include <glm/glm.hpp>
 #include <vector>
 
@@ -27,17 +28,20 @@ private:
 	const body* bB;
 	const physical_mesh* mA;
 	const physical_mesh* mB;
-	const glm::mat4 trAtoWorld;;
-	const glm::mat4 trBtoWorld;
-	const glm::mat4 trAtoB;;
-	const glm::mat4 trBtoA;
+	hull_cache own_cache_A;
+	hull_cache own_cache_B;
+	const hull_cache* cA;
+	const hull_cache* cB;
+	glm::mat4 trAtoB;
+	glm::mat4 trBtoA;
 	const bool was_colliding;
+	const float margin;
 	const penetration_data& prev_data;
 	penetration_data& next_data;
 	glm::vec3 edge_data[4];
 
 	penetration_data test_faces(actor);
-	float compute_face_penetration(const physical_mesh * other, const glm::mat4 tr, const face * face);
+	float compute_face_penetration(const physical_mesh * other, const hull_cache * other_cache, const glm::vec4& plane);
 	penetration_data test_edges();
 	bool test_gaussmap_intersect(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d, const glm::vec3& bCrossA, const glm::vec3& dCrossC)const;
 	float compute_edge_penetration(const glm::vec3& edge1_start, const glm::vec3& edge2_start, const glm::vec3& centroidA, const glm::vec3& edge1_dir, const glm::vec3& edge2_dir);
@@ -50,6 +54,7 @@ public:
 		actor m_actor;
 		float m_penetration{ FLT_MAX };
 		const face* m_face{ nullptr };
+		unsigned m_face_index{ 0u };
 		const half_edge* m_edgeA{ nullptr };
 		const half_edge* m_edgeB{ nullptr };
 	};
@@ -65,6 +70,6 @@ public:
 		simple_manifold m_manifold;
 	};
 
-	sat(const overlap_pair * pair);
+	sat(const overlap_pair * pair, float margin = 0.0f, const hull_cache* cache_A = nullptr, const hull_cache* cache_B = nullptr);
 	result test_collision();
 };
\ No newline at end of file
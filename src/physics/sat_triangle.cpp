@@ -0,0 +1,169 @@
+/**
+ * @file sat_triangle.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Separating Axis Theorem between a convex hull and a single triangle
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "sat_triangle.h"
+#include "physical_mesh.h"
+#include "math_utils.h"
+
+/**
+ * The triangle is given in space of B and moved into space of A,
+ * where the hull lives, so the hull data never gets transformed
+**/
+sat_triangle::sat_triangle(const physical_mesh * mA, const glm::mat4 & trAtoWorld, const glm::mat4 & trAtoB, const glm::mat4 & trBtoA, const glm::vec3(&tri)[3], float margin)
+	: mA(mA), trAtoWorld(trAtoWorld), trAtoB(trAtoB), m_margin(margin)
+{
+	for (int i = 0; i < 3; ++i)
+		m_tri[i] = tr_point(trBtoA, tri[i]);
+	m_normal = glm::cross(m_tri[1] - m_tri[0], m_tri[2] - m_tri[0]);
+}
+
+sat::result sat_triangle::test_collision()
+{
+	// Discard degenerated triangles
+	if (glm::length2(m_normal) < c_epsilon * c_epsilon)
+		return {};
+	m_normal = glm::normalize(m_normal);
+	// Triangles are one sided, ignore hulls behind them
+	if (glm::dot(-m_tri[0], m_normal) < 0.0f)
+		return {};
+
+	// Check triangle normal as separating axis
+	const float tri_pen = glm::dot(m_tri[0] - mA->support(-m_normal), m_normal);
+	if (tri_pen <= c_epsilon - m_margin)
+		return {};
+
+	// Check face normals of the hull as separating axis
+	float face_pen{ FLT_MAX };
+	for (auto it = mA->m_faces.cbegin(); it != mA->m_faces.cend(); ++it)
+	{
+		const glm::vec3 n = it->m_plane;
+		const float tri_min = glm::min(glm::dot(m_tri[0], n), glm::min(glm::dot(m_tri[1], n), glm::dot(m_tri[2], n)));
+		const float penetration = it->m_plane.w - tri_min;
+		if (penetration <= c_epsilon - m_margin)
+			return {};
+		if (penetration < face_pen)
+			face_pen = penetration, m_face = &*it;
+	}
+
+	// Check edge vs edge
+	float edge_pen{ FLT_MAX };
+	for (auto it = mA->m_hedges.cbegin(); it != mA->m_hedges.cend(); ++it)
+	{
+		// Avoid second computation for twin
+		const half_edge* edge1{ &*it };
+		if (edge1->m_twin < edge1)
+			continue;
+		const glm::vec3 edge1_start = mA->m_vertices[edge1->get_start()];
+		const glm::vec3 edge1_end = mA->m_vertices[edge1->get_end()];
+		for (int k = 0; k < 3; ++k)
+		{
+			const glm::vec3& edge2_start = m_tri[k];
+			const glm::vec3& edge2_end = m_tri[(k + 1) % 3];
+			// Compute penetration axis
+			glm::vec3 axis = glm::cross(edge1_end - edge1_start, edge2_end - edge2_start);
+			const float len = glm::length(axis);
+			if (len < c_epsilon)
+				continue;
+			axis /= len;
+			// Project both shapes on the axis
+			const float hull_max = glm::dot(mA->support(axis), axis);
+			const float hull_min = glm::dot(mA->support(-axis), axis);
+			const float tri_min = glm::min(glm::dot(m_tri[0], axis), glm::min(glm::dot(m_tri[1], axis), glm::dot(m_tri[2], axis)));
+			const float tri_max = glm::max(glm::dot(m_tri[0], axis), glm::max(glm::dot(m_tri[1], axis), glm::dot(m_tri[2], axis)));
+			// Keep the side with the smallest overlap, going from A to B
+			float penetration = hull_max - tri_min;
+			if (tri_max - hull_min < penetration)
+				penetration = tri_max - hull_min, axis = -axis;
+			if (penetration <= c_epsilon - m_margin)
+				return {};
+			if (penetration < edge_pen)
+			{
+				edge_pen = penetration;
+				m_edge_axis = axis;
+				m_edge_data[0] = edge1_start;
+				m_edge_data[1] = edge1_end;
+				m_edge_data[2] = edge2_start;
+				m_edge_data[3] = edge2_end;
+			}
+		}
+	}
+
+	// Check minimum penetration axis, biased as in sat for consistency
+	sat::actor min_actor{ sat::actor::B };
+	float min_pen{ tri_pen };
+	if (face_pen * 1.005f + 0.005f < tri_pen)
+		min_actor = sat::actor::A, min_pen = face_pen;
+	if (edge_pen * 1.005f + 0.005f < min_pen)
+		min_actor = sat::actor::Edge;
+	return generate_manifold(min_actor);
+}
+
+sat::result sat_triangle::generate_manifold(sat::actor a)
+{
+	sat::simple_manifold manifold;
+	// If we have an edge vs edge
+	if (a == sat::actor::Edge)
+	{
+		const auto closest = closest_point_segments(m_edge_data[0], m_edge_data[1], m_edge_data[2], m_edge_data[3]);
+		manifold.m_normal = glm::normalize(tr_vector(trAtoWorld, m_edge_axis));
+		manifold.m_local_A = { closest.first };
+		manifold.m_local_B = { tr_point(trAtoB, closest.second) };
+		return { true, manifold };
+	}
+	// If the triangle is the reference face
+	if (a == sat::actor::B)
+	{
+		// Find most antiparallel face of the hull
+		const face* faceInc = mA->find_most_antiparallel_face(m_normal);
+		std::vector<glm::vec3> verticesInc;
+		for (uint idx : faceInc->m_indices)
+			verticesInc.push_back(mA->m_vertices[idx]);
+		// Clip against the triangle sides
+		std::vector<std::pair<glm::vec3, glm::vec3> > clipPlanes;
+		for (int k = 0; k < 3; ++k)
+			clipPlanes.push_back({ glm::normalize(glm::cross(m_normal, m_tri[(k + 1) % 3] - m_tri[k])), m_tri[k] });
+		std::vector<glm::vec3> clipVertices = clip(verticesInc, clipPlanes);
+		// Normal goes from the hull into the triangle
+		manifold.m_normal = glm::normalize(tr_vector(trAtoWorld, -m_normal));
+		for (auto v : clipVertices)
+			if (glm::dot(m_tri[0] - v, m_normal) >= -m_margin)
+			{
+				manifold.m_local_A.push_back(v);
+				manifold.m_local_B.push_back(tr_point(trAtoB, project_point_plane(v, m_normal, m_tri[0])));
+			}
+	}
+	// If a face of the hull is the reference face
+	else
+	{
+		const glm::vec3 axisRef = m_face->m_plane;
+		std::vector<glm::vec3> verticesInc{ m_tri[0], m_tri[1], m_tri[2] };
+		// Clip against the reference face sides
+		std::vector<std::pair<glm::vec3, glm::vec3> > clipPlanes;
+		const half_edge* cur_hedge = m_face->m_hedge_start;
+		do
+		{
+			const glm::vec3 edgeA = mA->m_vertices[cur_hedge->get_start()];
+			const glm::vec3 edgeB = mA->m_vertices[cur_hedge->get_end()];
+			clipPlanes.push_back({ glm::normalize(glm::cross(axisRef, edgeB - edgeA)), edgeA });
+			cur_hedge = cur_hedge->m_next;
+		} while (cur_hedge != m_face->m_hedge_start);
+		std::vector<glm::vec3> clipVertices = clip(verticesInc, clipPlanes);
+		// Normal is the reference face normal
+		manifold.m_normal = glm::normalize(tr_vector(trAtoWorld, axisRef));
+		const glm::vec3 vtxRef = mA->m_vertices[m_face->m_indices[0]];
+		for (auto v : clipVertices)
+			if (glm::dot(vtxRef - v, axisRef) >= -m_margin)
+			{
+				manifold.m_local_A.push_back(project_point_plane(v, axisRef, vtxRef));
+				manifold.m_local_B.push_back(tr_point(trAtoB, v));
+			}
+	}
+	// Check if every point is clipped (corned case)
+	if (manifold.m_local_A.empty())
+		return {};
+	return { true, manifold };
+}
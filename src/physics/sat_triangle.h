@@ -0,0 +1,32 @@
+/**
+ * @file sat_triangle.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Separating Axis Theorem between a convex hull and a single triangle
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include "sat.h"
+#include <glm/glm.hpp>
+
+struct physical_mesh;
+struct face;
+
+class sat_triangle
+{
+	const physical_mesh* mA;
+	const glm::mat4& trAtoWorld;
+	const glm::mat4& trAtoB;
+	const float m_margin;
+	glm::vec3 m_tri[3];
+	glm::vec3 m_normal;
+	const face* m_face{ nullptr };
+	glm::vec3 m_edge_data[4];
+	glm::vec3 m_edge_axis;
+
+	sat::result generate_manifold(sat::actor a);
+
+public:
+	sat_triangle(const physical_mesh* mA, const glm::mat4& trAtoWorld, const glm::mat4& trAtoB, const glm::mat4& trBtoA, const glm::vec3 (&tri)[3], float margin = 0.0f);
+	sat::result test_collision();
+};
@@ -0,0 +1,130 @@
+/**
+ * @file simd.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Small wrappers over SSE/AVX2 registers for the wide contact solver
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include <glm/glm.hpp>
+
+// AVX2 when the compiler targets it, SSE on every x86-64, one scalar lane elsewhere
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE
+#endif
+#if defined(SIMD_AVX2) || defined(SIMD_SSE)
+#include <immintrin.h>
+#endif
+
+// Number of floats packed in a register
+#if defined(SIMD_AVX2)
+const unsigned c_simd_lanes{ 8u };
+#elif defined(SIMD_SSE)
+const unsigned c_simd_lanes{ 4u };
+#else
+const unsigned c_simd_lanes{ 1u };
+#endif
+
+/**
+ * One float per lane
+**/
+struct wide_float
+{
+#if defined(SIMD_AVX2)
+	__m256 m;
+	wide_float() : m(_mm256_setzero_ps()) {}
+	wide_float(__m256 v) : m(v) {}
+	explicit wide_float(float f) : m(_mm256_set1_ps(f)) {}
+#elif defined(SIMD_SSE)
+	__m128 m;
+	wide_float() : m(_mm_setzero_ps()) {}
+	wide_float(__m128 v) : m(v) {}
+	explicit wide_float(float f) : m(_mm_set1_ps(f)) {}
+#else
+	float m;
+	wide_float() : m(0.0f) {}
+	explicit wide_float(float f) : m(f) {}
+#endif
+	float& operator[](unsigned lane) { return reinterpret_cast<float*>(&m)[lane]; }
+	float operator[](unsigned lane)const { return reinterpret_cast<const float*>(&m)[lane]; }
+};
+
+#if defined(SIMD_AVX2)
+inline wide_float operator+(wide_float a, wide_float b) { return _mm256_add_ps(a.m, b.m); }
+inline wide_float operator-(wide_float a, wide_float b) { return _mm256_sub_ps(a.m, b.m); }
+inline wide_float operator*(wide_float a, wide_float b) { return _mm256_mul_ps(a.m, b.m); }
+inline wide_float wide_min(wide_float a, wide_float b) { return _mm256_min_ps(a.m, b.m); }
+inline wide_float wide_max(wide_float a, wide_float b) { return _mm256_max_ps(a.m, b.m); }
+inline wide_float operator/(wide_float a, wide_float b) { return _mm256_div_ps(a.m, b.m); }
+inline wide_float wide_sqrt(wide_float a) { return _mm256_sqrt_ps(a.m); }
+inline wide_float wide_load(const float* p) { return _mm256_loadu_ps(p); }
+inline void wide_store(float* p, wide_float a) { _mm256_storeu_ps(p, a.m); }
+#elif defined(SIMD_SSE)
+inline wide_float operator+(wide_float a, wide_float b) { return _mm_add_ps(a.m, b.m); }
+inline wide_float operator-(wide_float a, wide_float b) { return _mm_sub_ps(a.m, b.m); }
+inline wide_float operator*(wide_float a, wide_float b) { return _mm_mul_ps(a.m, b.m); }
+inline wide_float wide_min(wide_float a, wide_float b) { return _mm_min_ps(a.m, b.m); }
+inline wide_float wide_max(wide_float a, wide_float b) { return _mm_max_ps(a.m, b.m); }
+inline wide_float operator/(wide_float a, wide_float b) { return _mm_div_ps(a.m, b.m); }
+inline wide_float wide_sqrt(wide_float a) { return _mm_sqrt_ps(a.m); }
+inline wide_float wide_load(const float* p) { return _mm_loadu_ps(p); }
+inline void wide_store(float* p, wide_float a) { _mm_storeu_ps(p, a.m); }
+#else
+inline wide_float operator+(wide_float a, wide_float b) { return wide_float{ a.m + b.m }; }
+inline wide_float operator-(wide_float a, wide_float b) { return wide_float{ a.m - b.m }; }
+inline wide_float operator*(wide_float a, wide_float b) { return wide_float{ a.m * b.m }; }
+inline wide_float wide_min(wide_float a, wide_float b) { return wide_float{ glm::min(a.m, b.m) }; }
+inline wide_float wide_max(wide_float a, wide_float b) { return wide_float{ glm::max(a.m, b.m) }; }
+inline wide_float operator/(wide_float a, wide_float b) { return wide_float{ a.m / b.m }; }
+inline wide_float wide_sqrt(wide_float a) { return wide_float{ glm::sqrt(a.m) }; }
+inline wide_float wide_load(const float* p) { return wide_float{ *p }; }
+inline void wide_store(float* p, wide_float a) { *p = a.m; }
+#endif
+inline wide_float operator-(wide_float a) { return wide_float{} - a; }
+inline wide_float wide_abs(wide_float a) { return wide_max(a, -a); }
+inline wide_float wide_clamp(wide_float v, wide_float lo, wide_float hi) { return wide_min(wide_max(v, lo), hi); }
+
+/**
+ * One vector per lane, stored by component
+**/
+struct wide_vec3
+{
+	wide_float x, y, z;
+
+	glm::vec3 get(unsigned lane)const { return { x[lane], y[lane], z[lane] }; }
+	void set(unsigned lane, const glm::vec3& v) { x[lane] = v.x; y[lane] = v.y; z[lane] = v.z; }
+};
+
+inline wide_vec3 operator+(const wide_vec3& a, const wide_vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline wide_vec3 operator-(const wide_vec3& a, const wide_vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline wide_vec3 operator*(wide_float s, const wide_vec3& v) { return { s * v.x, s * v.y, s * v.z }; }
+inline wide_float dot(const wide_vec3& a, const wide_vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline wide_vec3 cross(const wide_vec3& a, const wide_vec3& b)
+{
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+inline wide_vec3 wide_clamp(const wide_vec3& v, const wide_vec3& lo, const wide_vec3& hi)
+{
+	return { wide_clamp(v.x, lo.x, hi.x), wide_clamp(v.y, lo.y, hi.y), wide_clamp(v.z, lo.z, hi.z) };
+}
+
+/**
+ * One matrix per lane, column major as glm
+**/
+struct wide_mat3
+{
+	wide_vec3 col[3];
+
+	void set(unsigned lane, const glm::mat3& m)
+	{
+		for (int c = 0; c < 3; ++c)
+			col[c].set(lane, m[c]);
+	}
+};
+
+inline wide_vec3 operator*(const wide_mat3& m, const wide_vec3& v)
+{
+	return v.x * m.col[0] + v.y * m.col[1] + v.z * m.col[2];
+}
@@ -0,0 +1,94 @@
+/**
+ * @file slot_map.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Generational handles to the elements of packed arrays
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "slot_map.h"
+
+bool slot_handle::operator==(const slot_handle & other) const
+{
+	return m_slot == other.m_slot && m_generation == other.m_generation;
+}
+bool slot_handle::operator!=(const slot_handle & other) const
+{
+	return !(*this == other);
+}
+bool slot_handle::operator<(const slot_handle & other) const
+{
+	return m_slot < other.m_slot || (m_slot == other.m_slot && m_generation < other.m_generation);
+}
+
+/**
+ * Handle for a new element, placed at the end of the arrays
+**/
+slot_handle slot_map::insert()
+{
+	// Reuse a free slot if any
+	uint s = m_free;
+	if (s != UINT_MAX)
+		m_free = m_slots[s].m_index;
+	else
+	{
+		s = static_cast<uint>(m_slots.size());
+		m_slots.push_back({ 0u, 0u });
+	}
+	m_slots[s].m_index = static_cast<uint>(m_element_slots.size());
+	m_element_slots.push_back(s);
+	return { s, m_slots[s].m_generation };
+}
+/**
+ * Frees the handle, returns the index of its element or UINT_MAX if it was stale.
+ * The caller moves the last element of its arrays into that index.
+**/
+uint slot_map::erase(slot_handle h)
+{
+	const uint index = find(h);
+	if (index == UINT_MAX)
+		return UINT_MAX;
+	// The last element takes the place of the removed one
+	const uint last = m_element_slots.back();
+	m_slots[last].m_index = index;
+	m_element_slots[index] = last;
+	m_element_slots.pop_back();
+	// Old handles to the slot go stale
+	slot& freed = m_slots[h.m_slot];
+	++freed.m_generation;
+	freed.m_index = m_free;
+	m_free = h.m_slot;
+	return index;
+}
+/**
+ * Index of the element, UINT_MAX if the handle is stale
+**/
+uint slot_map::find(slot_handle h) const
+{
+	if (h.m_slot >= m_slots.size() || m_slots[h.m_slot].m_generation != h.m_generation)
+		return UINT_MAX;
+	return m_slots[h.m_slot].m_index;
+}
+slot_handle slot_map::get_handle(uint index) const
+{
+	const uint s = m_element_slots[index];
+	return { s, m_slots[s].m_generation };
+}
+uint slot_map::size() const
+{
+	return static_cast<uint>(m_element_slots.size());
+}
+/**
+ * Frees every handle, the slots are reused from the first one
+**/
+void slot_map::clear()
+{
+	for (uint s : m_element_slots)
+		++m_slots[s].m_generation;
+	m_element_slots.clear();
+	m_free = UINT_MAX;
+	for (uint s = static_cast<uint>(m_slots.size()); s-- > 0u;)
+	{
+		m_slots[s].m_index = m_free;
+		m_free = s;
+	}
+}
@@ -0,0 +1,51 @@
+/**
+ * @file slot_map.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Generational handles to the elements of packed arrays
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include <vector>
+#include <climits>
+
+using uint = unsigned int;
+
+/**
+ * Stable reference to an element, goes stale once the element is removed
+**/
+struct slot_handle
+{
+	uint m_slot{ UINT_MAX };
+	uint m_generation{ 0u };
+
+	bool operator==(const slot_handle& other)const;
+	bool operator!=(const slot_handle& other)const;
+	bool operator<(const slot_handle& other)const;
+};
+
+/**
+ * Maps handles to the index of their element in packed arrays. Removing an
+ * element moves the last one into its place, so both operations are O(1).
+**/
+class slot_map
+{
+	struct slot
+	{
+		// Index of the element while used, next free slot otherwise
+		uint m_index;
+		uint m_generation;
+	};
+	std::vector<slot> m_slots;
+	// Slot of each element
+	std::vector<uint> m_element_slots;
+	uint m_free{ UINT_MAX };
+
+public:
+	slot_handle insert();
+	uint erase(slot_handle h);
+	uint find(slot_handle h)const;
+	slot_handle get_handle(uint index)const;
+	uint size()const;
+	void clear();
+};
@@ -0,0 +1,272 @@
+/**
+ * @file thread_pool.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Work stealing pool of worker threads running parallel loops and task graphs
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "thread_pool.h"
+#include <algorithm>
+
+// Pool the current thread works for and its index in it
+static thread_local const thread_pool* t_pool{ nullptr };
+static thread_local uint t_thread{ 0u };
+
+/**
+ * Add a task, returns its index
+**/
+uint task_graph::add(task fn)
+{
+	m_nodes.push_back({ std::move(fn), {}, 0u });
+	return static_cast<uint>(m_nodes.size() - 1u);
+}
+/**
+ * The task after only starts once the task before is done
+**/
+void task_graph::precede(uint before, uint after)
+{
+	m_nodes[before].m_successors.push_back(after);
+	++m_nodes[after].m_predecessors;
+}
+void task_graph::clear()
+{
+	m_nodes.clear();
+}
+uint task_graph::get_task_count() const
+{
+	return static_cast<uint>(m_nodes.size());
+}
+
+thread_pool::thread_pool(uint worker_count)
+{
+	worker_count = std::min(worker_count, c_max_workers);
+	// Thread 0 is the caller
+	m_thread_count = worker_count + 1u;
+	m_queues.reset(new queue[m_thread_count]);
+	for (uint i = 0; i < worker_count; ++i)
+		m_workers.emplace_back(&thread_pool::worker_loop, this, i + 1u);
+}
+
+thread_pool::~thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_exit = true;
+	}
+	m_wake.notify_all();
+	for (auto& w : m_workers)
+		w.join();
+}
+
+/**
+ * Splits [0, count) in batches run by the workers and the calling thread,
+ * returns once every batch is done. May be called from inside a task.
+**/
+void thread_pool::parallel_for(uint count, uint batch, const job & fn)
+{
+	if (count == 0u)
+		return;
+	const uint thread = get_thread_index();
+	// Not worth waking the workers
+	if (m_thread_count == 1u || count <= batch)
+	{
+		fn(0u, count, thread);
+		return;
+	}
+	// Split the whole range from this thread, the workers steal the halves
+	std::atomic<uint> pending{ count };
+	task t;
+	t.m_job = &fn;
+	t.m_end = count;
+	t.m_batch = batch > 0u ? batch : 1u;
+	t.m_pending = &pending;
+	execute(thread, t);
+	// Help until every batch is done
+	wait(thread, pending);
+}
+
+/**
+ * Runs every task of an acyclic graph, returns once they are all done.
+ * May be called from inside a task.
+**/
+void thread_pool::run(task_graph & graph)
+{
+	const uint count = graph.get_task_count();
+	if (count == 0u)
+		return;
+	const uint thread = get_thread_index();
+	// Reset the dependency counters
+	graph.m_waiting.reset(new std::atomic<uint>[count]);
+	for (uint i = 0; i < count; ++i)
+		graph.m_waiting[i] = graph.m_nodes[i].m_predecessors;
+	// Queue the tasks without dependencies
+	std::atomic<uint> pending{ count };
+	for (uint i = 0; i < count; ++i)
+	{
+		if (graph.m_nodes[i].m_predecessors > 0u)
+			continue;
+		task t;
+		t.m_graph = &graph;
+		t.m_node = i;
+		t.m_pending = &pending;
+		push(thread, t);
+	}
+	// Help until every task is done
+	wait(thread, pending);
+}
+
+/**
+ * Number of threads running a job, including the caller
+**/
+uint thread_pool::get_thread_count() const
+{
+	return m_thread_count;
+}
+
+/**
+ * One worker per hardware thread besides the caller
+**/
+uint thread_pool::get_default_worker_count()
+{
+	// hardware_concurrency reports 0 when it is not known
+	const uint hardware = std::thread::hardware_concurrency();
+	return hardware > 0u ? hardware - 1u : 0u;
+}
+
+/**
+ * Index of the calling thread, threads outside the pool are the caller
+**/
+uint thread_pool::get_thread_index() const
+{
+	return t_pool == this ? t_thread : 0u;
+}
+
+void thread_pool::push(uint thread, const task & t)
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_queues[thread].m_mutex };
+		m_queues[thread].m_tasks.push_back(t);
+	}
+	// Wake a worker if any is waiting for work
+	m_queued.fetch_add(1u);
+	if (m_sleeping.load() > 0u)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_wake.notify_one();
+	}
+}
+
+/**
+ * Newest task of the own queue, or the oldest of another thread
+**/
+bool thread_pool::pop(uint thread, task & t)
+{
+	const uint count = get_thread_count();
+	for (uint i = 0; i < count; ++i)
+	{
+		queue& q = m_queues[(thread + i) % count];
+		std::lock_guard<std::mutex> lock{ q.m_mutex };
+		if (q.m_tasks.empty())
+			continue;
+		if (i == 0u)
+		{
+			t = q.m_tasks.back();
+			q.m_tasks.pop_back();
+		}
+		else
+		{
+			t = q.m_tasks.front();
+			q.m_tasks.pop_front();
+		}
+		m_queued.fetch_sub(1u);
+		return true;
+	}
+	return false;
+}
+
+void thread_pool::execute(uint thread, task t)
+{
+	// Run a graph node and queue the successors it was the last dependency of
+	if (t.m_graph)
+	{
+		task_graph& graph = *t.m_graph;
+		graph.m_nodes[t.m_node].m_fn(thread);
+		for (uint next : graph.m_nodes[t.m_node].m_successors)
+		{
+			if (graph.m_waiting[next].fetch_sub(1u, std::memory_order_acq_rel) != 1u)
+				continue;
+			task n = t;
+			n.m_node = next;
+			push(thread, n);
+		}
+		finish(*t.m_pending, 1u);
+		return;
+	}
+	// Keep the first half of the range, leave the second one to be stolen
+	while (t.m_end - t.m_begin > t.m_batch)
+	{
+		const uint batches = (t.m_end - t.m_begin + t.m_batch - 1u) / t.m_batch;
+		task half = t;
+		half.m_begin = t.m_begin + batches / 2u * t.m_batch;
+		push(thread, half);
+		t.m_end = half.m_begin;
+	}
+	(*t.m_job)(t.m_begin, t.m_end, thread);
+	finish(*t.m_pending, t.m_end - t.m_begin);
+}
+
+/**
+ * Marks work of a loop or a graph as done, waking the threads waiting on it once all is done
+**/
+void thread_pool::finish(std::atomic<uint>& pending, uint amount)
+{
+	// The waiter may return as soon as it reaches 0, do not touch it after
+	if (pending.fetch_sub(amount) != amount)
+		return;
+	if (m_sleeping.load() > 0u)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_wake.notify_all();
+	}
+}
+
+void thread_pool::wait(uint thread, const std::atomic<uint>& pending)
+{
+	// Run queued work instead of blocking, it may be what is being waited on
+	task t;
+	while (pending.load() > 0u)
+	{
+		if (pop(thread, t))
+		{
+			execute(thread, t);
+			continue;
+		}
+		// The rest is running on other threads, sleep until it is done or more is queued
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		++m_sleeping;
+		m_wake.wait(lock, [&]() { return m_queued.load() > 0u || pending.load() == 0u; });
+		--m_sleeping;
+	}
+}
+
+void thread_pool::worker_loop(uint thread)
+{
+	t_pool = this;
+	t_thread = thread;
+	task t;
+	while (true)
+	{
+		if (pop(thread, t))
+		{
+			execute(thread, t);
+			continue;
+		}
+		// Sleep until something is queued
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		++m_sleeping;
+		m_wake.wait(lock, [this]() { return m_exit || m_queued.load() > 0u; });
+		--m_sleeping;
+		if (m_exit)
+			return;
+	}
+}
@@ -0,0 +1,107 @@
+/**
+ * @file thread_pool.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Work stealing pool of worker threads running parallel loops and task graphs
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <memory>
+
+using uint = unsigned int;
+
+/**
+ * Tasks and the order they must run in, built once and run by a thread_pool
+ * as many times as needed. Independent tasks run at the same time.
+**/
+class task_graph
+{
+public:
+	// Runs on the thread with the given index
+	using task = std::function<void(uint thread)>;
+
+	uint add(task fn);
+	void precede(uint before, uint after);
+	void clear();
+	uint get_task_count()const;
+
+private:
+	struct node
+	{
+		task m_fn;
+		std::vector<uint> m_successors;
+		uint m_predecessors{ 0u };
+	};
+	std::vector<node> m_nodes;
+	// Predecessors not finished yet during a run
+	std::unique_ptr<std::atomic<uint>[]> m_waiting;
+
+	friend class thread_pool;
+};
+
+class thread_pool
+{
+public:
+	// Runs the range [begin, end) from the thread with the given index
+	using job = std::function<void(uint begin, uint end, uint thread)>;
+	// Bigger worker counts are clamped
+	static const uint c_max_workers{ 64u };
+
+	thread_pool(uint worker_count = get_default_worker_count());
+	~thread_pool();
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	void parallel_for(uint count, uint batch, const job& fn);
+	void run(task_graph& graph);
+	uint get_thread_count()const;
+	static uint get_default_worker_count();
+
+private:
+	struct task
+	{
+		// Range of a parallel loop, split in halves while bigger than a batch
+		const job* m_job{ nullptr };
+		uint m_begin{ 0u };
+		uint m_end{ 0u };
+		uint m_batch{ 1u };
+		// Node of a graph when there is no job
+		task_graph* m_graph{ nullptr };
+		uint m_node{ 0u };
+		// Work left of the loop or the graph the task belongs to
+		std::atomic<uint>* m_pending{ nullptr };
+	};
+	// The owner pushes and pops at the back, the other threads steal from the front.
+	// A locked deque instead of a lock-free one: tasks are whole batches of bodies
+	// or pairs, so each queue is touched a few times per loop and rarely contended.
+	struct queue
+	{
+		std::mutex m_mutex;
+		std::deque<task> m_tasks;
+	};
+
+	uint get_thread_index()const;
+	void push(uint thread, const task& t);
+	bool pop(uint thread, task& t);
+	void execute(uint thread, task t);
+	void finish(std::atomic<uint>& pending, uint amount);
+	void wait(uint thread, const std::atomic<uint>& pending);
+	void worker_loop(uint thread);
+
+	std::vector<std::thread> m_workers;
+	// Set before the workers start, they read it while the others are created
+	uint m_thread_count{ 1u };
+	std::unique_ptr<queue[]> m_queues;
+	std::atomic<uint> m_queued{ 0u };
+	std::atomic<uint> m_sleeping{ 0u };
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_exit{ false };
+};
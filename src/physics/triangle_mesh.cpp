@@ -0,0 +1,183 @@
+/**
+ * @file triangle_mesh.cpp
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Static triangle soup with a bounding volume hierarchy
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#include "triangle_mesh.h"
+#include "math_utils.h"
+#include <algorithm>
+#include <numeric>
+
+const uint c_bvh_leaf_size{ 4u };
+
+/**
+ * Build the hierarchy, reordering the triangles so every leaf is contiguous
+**/
+void triangle_mesh::build()
+{
+	m_nodes.clear();
+	if (m_triangles.empty())
+		return;
+	// Precompute centroids
+	std::vector<glm::vec3> centroids(m_triangles.size());
+	for (uint i = 0; i < m_triangles.size(); ++i)
+	{
+		const glm::uvec3& t = m_triangles[i];
+		centroids[i] = (m_vertices[t.x] + m_vertices[t.y] + m_vertices[t.z]) / 3.0f;
+	}
+	// A binary tree with leaves of size N has at most 2*count/N nodes
+	m_nodes.reserve(2u * m_triangles.size() / c_bvh_leaf_size + 1u);
+	build_recursive(0u, static_cast<uint>(m_triangles.size()), centroids);
+	m_nodes.shrink_to_fit();
+}
+uint triangle_mesh::build_recursive(uint first, uint count, std::vector<glm::vec3>& centroids)
+{
+	// Create node
+	const uint node_idx = static_cast<uint>(m_nodes.size());
+	m_nodes.push_back({});
+	// Compute bounds
+	aabb box;
+	aabb centroid_box;
+	for (uint i = first; i < first + count; ++i)
+	{
+		const glm::uvec3& t = m_triangles[i];
+		box.add_point(m_vertices[t.x]);
+		box.add_point(m_vertices[t.y]);
+		box.add_point(m_vertices[t.z]);
+		centroid_box.add_point(centroids[i]);
+	}
+	m_nodes[node_idx].m_min = box.m_min;
+	m_nodes[node_idx].m_max = box.m_max;
+	// Create leaf
+	if (count <= c_bvh_leaf_size)
+	{
+		m_nodes[node_idx].m_index = first;
+		m_nodes[node_idx].m_count = count;
+		return node_idx;
+	}
+	// Split at the median on the longest centroid axis
+	const glm::vec3 extent = centroid_box.get_extent();
+	int axis = 0;
+	if (extent.y > extent[axis]) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+	const uint half = count / 2u;
+	std::vector<uint> order(count);
+	std::iota(order.begin(), order.end(), first);
+	std::nth_element(order.begin(), order.begin() + half, order.end(),
+		[&](uint a, uint b) { return centroids[a][axis] < centroids[b][axis]; });
+	// Apply the new order to triangles and centroids
+	std::vector<glm::uvec3> tris(count);
+	std::vector<glm::vec3> cents(count);
+	for (uint i = 0; i < count; ++i)
+		tris[i] = m_triangles[order[i]], cents[i] = centroids[order[i]];
+	std::copy(tris.begin(), tris.end(), m_triangles.begin() + first);
+	std::copy(cents.begin(), cents.end(), centroids.begin() + first);
+	// Build children, left is always next to the parent
+	build_recursive(first, half, centroids);
+	const uint right = build_recursive(first + half, count - half, centroids);
+	m_nodes[node_idx].m_index = right;
+	m_nodes[node_idx].m_count = 0u;
+	return node_idx;
+}
+/**
+ * Collect every triangle whose node bounds overlap the box
+**/
+void triangle_mesh::query(const aabb & box, std::vector<uint>& out) const
+{
+	if (m_nodes.empty())
+		return;
+	uint stack[64];
+	int top = 0;
+	stack[top++] = 0u;
+	while (top > 0)
+	{
+		const bvh_node& node = m_nodes[stack[--top]];
+		if (!box.overlaps({ node.m_min, node.m_max }))
+			continue;
+		if (node.is_leaf())
+		{
+			for (uint i = node.m_index; i < node.m_index + node.m_count; ++i)
+			{
+				// Check the triangle bounds
+				aabb tri_box;
+				tri_box.add_point(m_vertices[m_triangles[i].x]);
+				tri_box.add_point(m_vertices[m_triangles[i].y]);
+				tri_box.add_point(m_vertices[m_triangles[i].z]);
+				if (box.overlaps(tri_box))
+					out.push_back(i);
+			}
+		}
+		else
+		{
+			stack[top++] = node.m_index;
+			stack[top++] = static_cast<uint>(&node - m_nodes.data()) + 1u;
+		}
+	}
+}
+void triangle_mesh::get_triangle(uint idx, glm::vec3(&tri)[3]) const
+{
+	const glm::uvec3& t = m_triangles[idx];
+	tri[0] = m_vertices[t.x];
+	tri[1] = m_vertices[t.y];
+	tri[2] = m_vertices[t.z];
+}
+/**
+ * Perform ray intersection traversing the hierarchy
+**/
+ray_info triangle_mesh::ray_cast(const ray & local_ray) const
+{
+	ray_info info;
+	if (m_nodes.empty())
+		return info;
+	uint stack[64];
+	int top = 0;
+	stack[top++] = 0u;
+	while (top > 0)
+	{
+		const bvh_node& node = m_nodes[stack[--top]];
+		if (!aabb{ node.m_min, node.m_max }.ray_cast(local_ray, info.m_time))
+			continue;
+		if (node.is_leaf())
+		{
+			for (uint i = node.m_index; i < node.m_index + node.m_count; ++i)
+			{
+				glm::vec3 tri[3];
+				get_triangle(i, tri);
+				const float time = ray_cast_triangle(local_ray, tri[0], tri[1], tri[2]);
+				if (time >= 0.0f && time < info.m_time)
+				{
+					info.m_intersected = true;
+					info.m_time = time;
+					info.m_normal = glm::normalize(glm::cross(tri[1] - tri[0], tri[2] - tri[0]));
+				}
+			}
+		}
+		else
+		{
+			stack[top++] = node.m_index;
+			stack[top++] = static_cast<uint>(&node - m_nodes.data()) + 1u;
+		}
+	}
+	return info;
+}
+/**
+ * Extract the triangles of the mesh
+**/
+std::pair<std::vector<glm::vec3>, std::vector<glm::vec3>> triangle_mesh::get_triangles() const
+{
+	std::vector<glm::vec3> tri;
+	std::vector<glm::vec3> norm;
+	tri.reserve(m_triangles.size() * 3u);
+	norm.reserve(m_triangles.size() * 3u);
+	for (uint i = 0; i < m_triangles.size(); ++i)
+	{
+		glm::vec3 t[3];
+		get_triangle(i, t);
+		const glm::vec3 n = glm::normalize(glm::cross(t[1] - t[0], t[2] - t[0]));
+		for (int j = 0; j < 3; ++j)
+			tri.push_back(t[j]), norm.push_back(n);
+	}
+	return { tri,norm };
+}
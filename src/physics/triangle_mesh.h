@@ -0,0 +1,42 @@
+/**
+ * @file triangle_mesh.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Static triangle soup with a bounding volume hierarchy
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include "physical_mesh.h"
+#include "aabb.h"
+#include <vector>
+
+/**
+ * Compact BVH node (32 bytes). Inner nodes store its left child right after
+ * itself and the right child at m_index, leaves store a triangle range.
+**/
+struct bvh_node
+{
+	glm::vec3 m_min;
+	uint m_index;
+	glm::vec3 m_max;
+	uint m_count;
+
+	bool is_leaf()const { return m_count > 0u; }
+};
+
+struct triangle_mesh
+{
+	std::vector<glm::vec3> m_vertices;
+	std::vector<glm::uvec3> m_triangles;
+	std::vector<bvh_node> m_nodes;
+
+	void build();
+	void query(const aabb& box, std::vector<uint>& out)const;
+	void get_triangle(uint idx, glm::vec3 (&tri)[3])const;
+	ray_info ray_cast(const ray& local_ray)const;
+	std::pair<std::vector<glm::vec3>,
+		std::vector<glm::vec3> > get_triangles()const;
+
+private:
+	uint build_recursive(uint first, uint count, std::vector<glm::vec3>& centroids);
+};
@@ -0,0 +1,54 @@
+/**
+ * @file triple_buffer.h
+ * @author Gabriel Maneru, gabriel.m, gabriel.m@digipen.edu
+ * @date 01/28/2020
+ * @brief Lock-free buffer handing the latest state from one writer thread to one reader thread
+ * @copyright Copyright (C) 2020 DigiPen Institute of Technology.
+**/
+#pragma once
+#include <atomic>
+
+using uint = unsigned int;
+
+/**
+ * The writer fills the back slot and swaps it with the middle one, the reader
+ * swaps the middle slot into the front when a newer one was published.
+ * Neither side ever waits for the other.
+**/
+template<typename T>
+class triple_buffer
+{
+	// Set on the middle index when it holds a slot the reader has not seen
+	static const uint c_fresh{ 4u };
+
+	T m_slots[3];
+	std::atomic<uint> m_middle{ 1u };
+	uint m_back{ 0u };
+	uint m_front{ 2u };
+
+public:
+	/**
+	 * Slot to fill, owned by the writer until published
+	**/
+	T& back()
+	{
+		return m_slots[m_back];
+	}
+	/**
+	 * Hand the back slot to the reader
+	**/
+	void publish()
+	{
+		m_back = m_middle.exchange(m_back | c_fresh, std::memory_order_acq_rel) & ~c_fresh;
+	}
+	/**
+	 * Latest published slot, owned by the reader until the next call
+	**/
+	const T& front()
+	{
+		// Only swap when there is something new, keep the current one otherwise
+		if (m_middle.load(std::memory_order_relaxed) & c_fresh)
+			m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & ~c_fresh;
+		return m_slots[m_front];
+	}
+};